@@ -0,0 +1,129 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *  \brief Application Configuration Header File
+ *
+ *  This header file is used to configure the application's compile time
+ *  options, as an alternative to passing the constants through the makefile.
+ */
+
+#ifndef _APP_CONFIG_H_
+#define _APP_CONFIG_H_
+
+	/* Scheduler Related Tokens: */
+		/** Frequency of the scheduler tick generated by Timer0, in Hz. */
+		#define SCHEDULER_TICK_HZ                1000
+
+		/** Per-task cycle budgets. These are estimates from the code paths, not measurements: the
+		 *  UART task parsing \ref UART_TASK_MAX_BYTES bytes, the endpoint task writing one 27-byte
+		 *  report, and so on, doubled for headroom. A task that runs longer than its budget is
+		 *  counted as an overrun; check Scheduler_Task_t::WorstTicks with tools/boot_trace.py
+		 *  --tasks after a soak run on the target and tighten them to the measured worst case plus
+		 *  headroom.
+		 */
+		#define TASK_BUDGET_UART_CYCLES          800
+		#define TASK_BUDGET_PLAN_CYCLES          800
+		#define TASK_BUDGET_ENDPOINT_CYCLES      2400
+		#define TASK_BUDGET_HOUSEKEEPING_CYCLES  400
+		#define TASK_BUDGET_MIDI_STREAM_CYCLES   1200
+
+		/** Budget for the time a USB interrupt may keep interrupts disabled, in cycles. The USART1
+		 *  receive interrupt can be held off for two byte times (10,240 cycles), but the ICP1 input
+		 *  capture of MIDI IN2 has to read each edge before the next one, which can follow a single
+		 *  bit time (512 cycles) later; the budget leaves room for the capture interrupt itself, and
+		 *  USBInterrupts.c refuses to build with a budget of a bit time or more. Runs over this budget
+		 *  are counted in USBInterrupts_Stats_t::Overruns.
+		 */
+		#define USB_ISR_BLOCKED_BUDGET_CYCLES    400
+
+		/** Maximum number of received bytes the UART task parses in a single run. */
+		#define UART_TASK_MAX_BYTES              8
+
+	/* MIDI Input Related Tokens: */
+		/** Adds a second MIDI input on ICP1 (PD4), received in software from Timer1 input capture
+		 *  timestamps and merged with USART1 in timestamp order. Needs a second opto-isolated input
+		 *  circuit on that pin; the pull-up keeps an unconnected input idle.
+		 */
+//		#define ENABLE_MIDI_IN2
+
+		/** Size of each MIDI input receive ring, must be a power of two. */
+		#define UART_RX_RING_SIZE                32
+
+		/** Size of the parsed MIDI message queue, must be a power of two. */
+		#define MIDI_QUEUE_SIZE                  8
+
+	/* USB-MIDI Passthrough Related Tokens: */
+		/** Adds a USB-MIDI streaming interface next to the HID interface, forwarding every parsed
+		 *  channel message to the host as USB-MIDI event packets. Leave disabled for console use.
+		 */
+//		#define ENABLE_USB_MIDI
+
+		/** Size of the USB-MIDI event packet queue, must be a power of two. */
+		#define MIDI_STREAM_QUEUE_SIZE           32
+
+	/* MIDI THRU Related Tokens: */
+		/** Forwards every byte received on USART1 out of USART1 TX (PD3) from the receive interrupt, for
+		 *  a sound module driven from the adapter. Needs a MIDI OUT circuit on that pin.
+		 */
+//		#define ENABLE_MIDI_THRU
+
+		/** Size of the THRU transmit ring, must be a power of two. */
+		#define MIDI_THRU_RING_SIZE              8
+
+		/** Drops all realtime bytes (clock, start/stop, active sensing, reset) from the THRU output. */
+//		#define MIDI_THRU_FILTER_REALTIME
+
+		/** Drops only active sensing (0xFE) from the THRU output. */
+//		#define MIDI_THRU_FILTER_ACTIVE_SENSING
+
+		/** Translates note numbers on the THRU output through MIDIThru_NoteMap in MIDIThru.c. */
+//		#define MIDI_THRU_REMAP_NOTES
+
+	/* Clock Synchronisation Related Tokens: */
+		/** Timestamps every USB start of frame for the host clock synchronisation in tools/clocksync.py,
+		 *  which then tracks timebase drift against the host controller's 1ms frame clock. Costs one
+		 *  short USB general interrupt per millisecond.
+		 */
+//		#define ENABLE_CLOCK_SYNC
+
+		/** Diagnostic builds only: replaces the vendor16 report fields with timestamps for end-to-end
+		 *  latency measurement with tools/hit_latency.py. vendor16[0..1] hold the 32-bit timebase time
+		 *  the MIDI message behind the report arrived, vendor16[2] the low 16 bits of the time the
+		 *  report was written to the endpoint and vendor16[3] the USB frame number at that moment.
+		 *  Not for console use.
+		 */
+//		#define DIAG_REPORT_TIMESTAMPS
+
+	/* Flight Recorder Related Tokens: */
+		/** Keeps the most recent MIDI, report queue and report endpoint events in a RAM ring that can
+		 *  be frozen and read out with tools/flight_recorder.py. Adds about 40 cycles per parsed
+		 *  message and per report, estimated from the instruction count, and 6 bytes of RAM per
+		 *  record; comment out to drop both.
+		 */
+		#define ENABLE_FLIGHT_RECORDER
+
+		/** Number of 6-byte flight recorder records, must be a power of two no larger than 256. A hit
+		 *  and its release take about six plus one or two time records, so 128 cover a few seconds
+		 *  of play.
+		 */
+		#define FLIGHT_RECORDER_RECORDS          128
+
+		/** Note number that freezes the flight recorder when received as a note on, 0xFF for none.
+		 *  The host can change it at run time when re-arming the recorder.
+		 */
+		#define FLIGHT_RECORDER_TRIGGER_NOTE     0xFF
+
+		/** Third byte of the SysEx F0 7D <id> ... F7 that freezes the flight recorder. */
+		#define FLIGHT_RECORDER_SYSEX_ID         0x46
+
+#endif
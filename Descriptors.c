@@ -13,82 +13,23 @@
  */
 
 #include "Descriptors.h"
+#include "HIDReportDescriptor.h"
 
-const USB_Descriptor_HIDReport_Datatype_t PROGMEM HIDReport[] =
+/** HID report descriptor. Like the other descriptors it is kept in RAM (USE_RAM_DESCRIPTORS) so the
+ *  control endpoint copies it out during enumeration without program memory reads. The items
+ *  themselves live in HIDReportDescriptor.h so the Linux daemon presents the same descriptor.
+ */
+const USB_Descriptor_HIDReport_Datatype_t HIDReport[] =
 {
-    HID_RI_USAGE_PAGE(8, 0x01),            /* Generic Desktop */
-    HID_RI_USAGE(8, 0x05),                 /* Game Pad */
-    HID_RI_COLLECTION(8, 0x01),            /* Application */
-        HID_RI_LOGICAL_MINIMUM(8, 0x00),
-        HID_RI_LOGICAL_MAXIMUM(8, 0x01),
-        HID_RI_PHYSICAL_MINIMUM(8, 0x00),
-        HID_RI_PHYSICAL_MAXIMUM(8, 0x01),
-        HID_RI_REPORT_SIZE(8, 0x01),
-        HID_RI_REPORT_COUNT(8, 0x0D),
-        HID_RI_USAGE_PAGE(8, 0x09),        /* Button */
-        HID_RI_USAGE_MINIMUM(8, 0x01),
-        HID_RI_USAGE_MAXIMUM(8, 0x0D),
-        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_REPORT_COUNT(8, 0x03),
-        HID_RI_INPUT(8, HID_IOF_CONSTANT),
-        HID_RI_USAGE_PAGE(8, 0x01),        /* Generic Desktop */
-        HID_RI_LOGICAL_MAXIMUM(8, 0x07),
-        HID_RI_PHYSICAL_MAXIMUM(16, 0x013B),
-        HID_RI_REPORT_SIZE(8, 0x04),
-        HID_RI_REPORT_COUNT(8, 0x01),
-        HID_RI_UNIT(8, 0x14),              /* Rotation (Eng. Pos) */
-        HID_RI_USAGE(8, 0x39),             /* Hat switch */
-        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NULLSTATE),
-        HID_RI_UNIT(8, 0x00),
-        HID_RI_REPORT_COUNT(8, 0x01),
-        HID_RI_INPUT(8, HID_IOF_CONSTANT),
-        HID_RI_LOGICAL_MAXIMUM(16, 0x00FF),
-        HID_RI_PHYSICAL_MAXIMUM(16, 0x00FF),
-        HID_RI_USAGE(8, 0x30),             /* X */
-        HID_RI_USAGE(8, 0x31),             /* Y */
-        HID_RI_USAGE(8, 0x32),             /* Z */
-        HID_RI_USAGE(8, 0x35),             /* Rz */
-        HID_RI_REPORT_SIZE(8, 0x08),
-        HID_RI_REPORT_COUNT(8, 0x04),
-        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_USAGE_PAGE(16, 0xFF00),     /* Vendor-defined */
-        HID_RI_USAGE(8, 0x20),
-        HID_RI_USAGE(8, 0x21),
-        HID_RI_USAGE(8, 0x22),
-        HID_RI_USAGE(8, 0x23),
-        HID_RI_USAGE(8, 0x24),
-        HID_RI_USAGE(8, 0x25),
-        HID_RI_USAGE(8, 0x26),
-        HID_RI_USAGE(8, 0x27),
-        HID_RI_USAGE(8, 0x28),
-        HID_RI_USAGE(8, 0x29),
-        HID_RI_USAGE(8, 0x2A),
-        HID_RI_USAGE(8, 0x2B),
-        HID_RI_REPORT_COUNT(8, 0x0C),
-        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_USAGE(16, 0x2621),          /* Vendor-defined */
-        HID_RI_REPORT_COUNT(8, 0x08),
-        HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_USAGE(16, 0x2621),          /* Vendor-defined */
-        HID_RI_OUTPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_LOGICAL_MAXIMUM(16, 0x03FF),
-        HID_RI_PHYSICAL_MAXIMUM(16, 0x03FF),
-        HID_RI_USAGE(8, 0x2C),
-        HID_RI_USAGE(8, 0x2D),
-        HID_RI_USAGE(8, 0x2E),
-        HID_RI_USAGE(8, 0x2F),
-        HID_RI_REPORT_SIZE(8, 0x10),
-        HID_RI_REPORT_COUNT(8, 0x04),
-        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-    HID_RI_END_COLLECTION(0),
+	ROCKBAND_HID_REPORT_DESCRIPTOR
 };
 
-/** Device descriptor structure. This descriptor, located in FLASH memory, describes the overall
+/** Device descriptor structure. This descriptor, located in RAM, describes the overall
  *  device characteristics, including the supported USB version, control endpoint size and the
  *  number of device configurations. The descriptor is read out by the USB host when the enumeration
  *  process begins.
  */
-const USB_Descriptor_Device_t PROGMEM DeviceDescriptor =
+const USB_Descriptor_Device_t DeviceDescriptor =
 {
 	.Header                 = {.Size = sizeof(USB_Descriptor_Device_t), .Type = DTYPE_Device},
 
@@ -101,7 +42,12 @@ const USB_Descriptor_Device_t PROGMEM DeviceDescriptor =
 
 	.VendorID               = 0x1BAD,
 	.ProductID              = 0x3110,
+	#if defined(ENABLE_USB_MIDI)
+	/* Different release so hosts that cache the interface layout per VID/PID/release re-read it */
+	.ReleaseNumber          = VERSION_BCD(2,1,0),
+	#else
 	.ReleaseNumber          = VERSION_BCD(2,0,0),
+	#endif
 
 	.ManufacturerStrIndex   = STRING_ID_Manufacturer,
 	.ProductStrIndex        = STRING_ID_Product,
@@ -110,19 +56,23 @@ const USB_Descriptor_Device_t PROGMEM DeviceDescriptor =
 	.NumberOfConfigurations = FIXED_NUM_CONFIGURATIONS
 };
 
-/** Configuration descriptor structure. This descriptor, located in FLASH memory, describes the usage
+/** Configuration descriptor structure. This descriptor, located in RAM, describes the usage
  *  of the device in one of its supported configurations, including information about any device interfaces
  *  and endpoints. The descriptor is read out by the USB host during the enumeration process when selecting
  *  a configuration so that the host may correctly communicate with the USB device.
  */
-const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
+const USB_Descriptor_Configuration_t ConfigurationDescriptor =
 {
 	.Config =
 		{
 			.Header                 = {.Size = sizeof(USB_Descriptor_Configuration_Header_t), .Type = DTYPE_Configuration},
 
 			.TotalConfigurationSize = sizeof(USB_Descriptor_Configuration_t),
+			#if defined(ENABLE_USB_MIDI)
+			.TotalInterfaces        = 3,
+			#else
 			.TotalInterfaces        = 1,
+			#endif
 
 			.ConfigurationNumber    = 1,
 			.ConfigurationStrIndex  = NO_DESCRIPTOR,
@@ -178,25 +128,134 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
 			.EndpointSize           = HID_IO_EPSIZE,
 			.PollingIntervalMS      = 0x0A
 		},
+
+	#if defined(ENABLE_USB_MIDI)
+	.Audio_ControlInterface =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+			.InterfaceNumber        = INTERFACE_ID_AudioControl,
+			.AlternateSetting       = 0x00,
+
+			.TotalEndpoints         = 0,
+
+			.Class                  = AUDIO_CSCP_AudioClass,
+			.SubClass               = AUDIO_CSCP_ControlSubclass,
+			.Protocol               = AUDIO_CSCP_ControlProtocol,
+
+			.InterfaceStrIndex      = NO_DESCRIPTOR
+		},
+
+	.Audio_ControlInterface_SPC =
+		{
+			.Header                 = {.Size = sizeof(USB_Audio_Descriptor_Interface_AC_t), .Type = AUDIO_DTYPE_CSInterface},
+			.Subtype                = AUDIO_DSUBTYPE_CSInterface_Header,
+
+			.ACSpecification        = VERSION_BCD(1,0,0),
+			.TotalLength            = sizeof(USB_Audio_Descriptor_Interface_AC_t),
+
+			.InCollection           = 1,
+			.InterfaceNumber        = INTERFACE_ID_AudioStream,
+		},
+
+	.Audio_StreamInterface =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+			.InterfaceNumber        = INTERFACE_ID_AudioStream,
+			.AlternateSetting       = 0x00,
+
+			.TotalEndpoints         = 1,
+
+			.Class                  = AUDIO_CSCP_AudioClass,
+			.SubClass               = AUDIO_CSCP_MIDIStreamingSubclass,
+			.Protocol               = AUDIO_CSCP_StreamingProtocol,
+
+			.InterfaceStrIndex      = NO_DESCRIPTOR
+		},
+
+	.Audio_StreamInterface_SPC =
+		{
+			.Header                 = {.Size = sizeof(USB_MIDI_Descriptor_AudioInterface_AS_t), .Type = AUDIO_DTYPE_CSInterface},
+			.Subtype                = AUDIO_DSUBTYPE_CSInterface_General,
+
+			.AudioSpecification     = VERSION_BCD(1,0,0),
+
+			.TotalLength            = (sizeof(USB_Descriptor_Configuration_t) -
+			                           offsetof(USB_Descriptor_Configuration_t, Audio_StreamInterface_SPC))
+		},
+
+	/* The kit's MIDI IN socket, routed to the host through the embedded OUT jack below */
+	.MIDI_In_Jack_Ext =
+		{
+			.Header                 = {.Size = sizeof(USB_MIDI_Descriptor_InputJack_t), .Type = AUDIO_DTYPE_CSInterface},
+			.Subtype                = AUDIO_DSUBTYPE_CSInterface_InputTerminal,
+
+			.JackType               = MIDI_JACKTYPE_External,
+			.JackID                 = 0x01,
+
+			.JackStrIndex           = NO_DESCRIPTOR
+		},
+
+	.MIDI_Out_Jack_Emb =
+		{
+			.Header                 = {.Size = sizeof(USB_MIDI_Descriptor_OutputJack_t), .Type = AUDIO_DTYPE_CSInterface},
+			.Subtype                = AUDIO_DSUBTYPE_CSInterface_OutputTerminal,
+
+			.JackType               = MIDI_JACKTYPE_Embedded,
+			.JackID                 = 0x02,
+
+			.NumberOfPins           = 1,
+			.SourceJackID           = {0x01},
+			.SourcePinID            = {0x01},
+
+			.JackStrIndex           = NO_DESCRIPTOR
+		},
+
+	.MIDI_Out_Jack_Endpoint =
+		{
+			.Endpoint =
+				{
+					.Header            = {.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t), .Type = DTYPE_Endpoint},
+
+					.EndpointAddress   = MIDI_STREAM_IN_EPADDR,
+					.Attributes        = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+					.EndpointSize      = MIDI_STREAM_EPSIZE,
+					.PollingIntervalMS = 0x01
+				},
+
+			.Refresh                = 0,
+			.SyncEndpointNumber     = 0
+		},
+
+	.MIDI_Out_Jack_Endpoint_SPC =
+		{
+			.Header                 = {.Size = sizeof(USB_MIDI_Descriptor_Jack_Endpoint_t), .Type = AUDIO_DTYPE_CSEndpoint},
+			.Subtype                = AUDIO_DSUBTYPE_CSEndpoint_General,
+
+			.TotalEmbeddedJacks     = 0x01,
+			.AssociatedJackID       = {0x02}
+		},
+	#endif
 };
 
-/** Language descriptor structure. This descriptor, located in FLASH memory, is returned when the host requests
+/** Language descriptor structure. This descriptor, located in RAM, is returned when the host requests
  *  the string descriptor with index 0 (the first index). It is actually an array of 16-bit integers, which indicate
  *  via the language ID table available at USB.org what languages the device supports for its string descriptors.
  */
-const USB_Descriptor_String_t PROGMEM LanguageString = USB_STRING_DESCRIPTOR_ARRAY(LANGUAGE_ID_ENG);
+const USB_Descriptor_String_t LanguageString = USB_STRING_DESCRIPTOR_ARRAY(LANGUAGE_ID_ENG);
 
 /** Manufacturer descriptor string. This is a Unicode string containing the manufacturer's details in human readable
  *  form, and is read out upon request by the host when the appropriate string ID is requested, listed in the Device
  *  Descriptor.
  */
-const USB_Descriptor_String_t PROGMEM ManufacturerString = USB_STRING_DESCRIPTOR(L"Licenced by Nintendo of America ");
+const USB_Descriptor_String_t ManufacturerString = USB_STRING_DESCRIPTOR(L"Licenced by Nintendo of America ");
 
 /** Product descriptor string. This is a Unicode string containing the product's details in human readable form,
  *  and is read out upon request by the host when the appropriate string ID is requested, listed in the Device
  *  Descriptor.
  */
-const USB_Descriptor_String_t PROGMEM ProductString = USB_STRING_DESCRIPTOR(L"Harmonix Drum Controller for Nintendo Wii");
+const USB_Descriptor_String_t ProductString = USB_STRING_DESCRIPTOR(L"Harmonix Drum Controller for Nintendo Wii");
 
 /** This function is called by the library when in device mode, and must be overridden (see library "USB Descriptors"
  *  documentation) by the application code so that the address and size of a requested descriptor can be given
@@ -229,15 +288,15 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
 			{
 				case STRING_ID_Language:
 					Address = &LanguageString;
-					Size    = pgm_read_byte(&LanguageString.Header.Size);
+					Size    = LanguageString.Header.Size;
 					break;
 				case STRING_ID_Manufacturer:
 					Address = &ManufacturerString;
-					Size    = pgm_read_byte(&ManufacturerString.Header.Size);
+					Size    = ManufacturerString.Header.Size;
 					break;
 				case STRING_ID_Product:
 					Address = &ProductString;
-					Size    = pgm_read_byte(&ProductString.Header.Size);
+					Size    = ProductString.Header.Size;
 					break;
 			}
 			break;
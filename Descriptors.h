@@ -41,6 +41,8 @@
 
 		#include <avr/pgmspace.h>
 
+		#include "Config/AppConfig.h"
+
 	/* Macros: */
 		/** Endpoint address of the Bulk Vendor device-to-host data IN endpoint. */
 		#define HID_IN_EPADDR               (ENDPOINT_DIR_IN  | 1)
@@ -51,6 +53,12 @@
 		/** Size in bytes of the Bulk Vendor data endpoints. */
 		#define HID_IO_EPSIZE               	64
 
+		/** Endpoint address of the USB-MIDI streaming device-to-host bulk IN endpoint. */
+		#define MIDI_STREAM_IN_EPADDR       (ENDPOINT_DIR_IN  | 3)
+
+		/** Size in bytes of the USB-MIDI streaming endpoint, sixteen 4-byte event packets. */
+		#define MIDI_STREAM_EPSIZE          64
+
 	/* Type Defines: */
 		/** Type define for the device configuration descriptor structure. This must be defined in the
 		 *  application code, as the configuration descriptor contains several sub-descriptors which
@@ -66,6 +74,19 @@
 			USB_Descriptor_Endpoint_t             HID_ReportINEndpoint;
 			USB_Descriptor_Endpoint_t             HID_ReportOUTEndpoint;
 
+			#if defined(ENABLE_USB_MIDI)
+			// MIDI Audio Control Interface
+			USB_Descriptor_Interface_t                Audio_ControlInterface;
+			USB_Audio_Descriptor_Interface_AC_t       Audio_ControlInterface_SPC;
+
+			// MIDI Audio Streaming Interface
+			USB_Descriptor_Interface_t                Audio_StreamInterface;
+			USB_MIDI_Descriptor_AudioInterface_AS_t   Audio_StreamInterface_SPC;
+			USB_MIDI_Descriptor_InputJack_t           MIDI_In_Jack_Ext;
+			USB_MIDI_Descriptor_OutputJack_t          MIDI_Out_Jack_Emb;
+			USB_Audio_Descriptor_StreamEndpoint_Std_t MIDI_Out_Jack_Endpoint;
+			USB_MIDI_Descriptor_Jack_Endpoint_t       MIDI_Out_Jack_Endpoint_SPC;
+			#endif
 		} USB_Descriptor_Configuration_t;
 
 		/** Enum for the device interface descriptor IDs within the device. Each interface descriptor
@@ -74,7 +95,11 @@
 		 */
 		enum InterfaceDescriptors_t
 		{
-			INTERFACE_ID_HID     = 0,
+			INTERFACE_ID_HID          = 0,
+			#if defined(ENABLE_USB_MIDI)
+			INTERFACE_ID_AudioControl = 1, /**< Audio control interface descriptor ID */
+			INTERFACE_ID_AudioStream  = 2, /**< MIDI streaming interface descriptor ID */
+			#endif
 		};
 
 		/** Enum for the device string descriptor IDs within the device. Each string descriptor should
@@ -0,0 +1,182 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Vendor feature report diagnostics channel. Feature GET_REPORT and SET_REPORT requests are
+ *  handled from USB_COM_vect as soon as their SETUP arrives (INTERRUPT_CONTROL_ENDPOINT in
+ *  Config/LUFAConfig.h), not from USB_USBTask() in the housekeeping task. That interrupt
+ *  preempts the main loop, so block data is copied out as-is without locking; multi-byte values
+ *  that the main loop is updating at that moment may read torn.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+
+#include "Diagnostics.h"
+#include "Scheduler.h"
+#include "MIDIInput.h"
+#include "FlightRecorder.h"
+#include "MIDIThru.h"
+#include "MIDIStream.h"
+#include "USBInterrupts.h"
+
+BootTrace_t BootTrace;
+
+/** Last clock synchronisation sample, see \ref DIAG_BLOCK_CLOCK. */
+static ClockSample_t ClockSample;
+
+/** Frame number and time of the last start of frame, updated from the USB general interrupt. */
+static uint16_t SofFrame;
+static uint32_t SofTime;
+
+/** Currently selected block and read offset, set by \ref DIAG_CMD_SELECT. */
+static uint8_t  SelectedBlock;
+static uint16_t SelectedOffset;
+
+/** Looks up the address and size of a diagnostic block.
+ *
+ *  \param[in]  Block  Block ID, a value from \ref Diagnostics_Block_t.
+ *  \param[out] Size   Size of the block in bytes, zero if the block does not exist.
+ *
+ *  \return Address of the block in RAM.
+ */
+static const uint8_t* Diagnostics_GetBlock(const uint8_t Block,
+                                           uint16_t* const Size)
+{
+	switch (Block)
+	{
+		case DIAG_BLOCK_BOOT_TRACE:
+			*Size = sizeof(BootTrace);
+			return (const uint8_t*)&BootTrace;
+		case DIAG_BLOCK_SCHEDULER_STATS:
+			*Size = sizeof(Scheduler_Stats);
+			return (const uint8_t*)&Scheduler_Stats;
+		case DIAG_BLOCK_SCHEDULER_TASKS:
+			*Size = Scheduler_TotalTasks * sizeof(Scheduler_Task_t);
+			return (const uint8_t*)Scheduler_Tasks;
+		case DIAG_BLOCK_MIDI_INPUT:
+			*Size = sizeof(MIDIInput_Stats);
+			return (const uint8_t*)MIDIInput_Stats;
+#if defined(ENABLE_FLIGHT_RECORDER)
+		case DIAG_BLOCK_FLIGHT_RECORDER:
+			/* The records are only consistent once nothing writes to them any more */
+			*Size = FlightRecorder.Frozen ? sizeof(FlightRecorder) : offsetof(FlightRecorder_t, Records);
+			return (const uint8_t*)&FlightRecorder;
+#endif
+#if defined(ENABLE_MIDI_THRU)
+		case DIAG_BLOCK_MIDI_THRU:
+			*Size = sizeof(MIDIThru_Stats);
+			return (const uint8_t*)&MIDIThru_Stats;
+#endif
+		case DIAG_BLOCK_CLOCK:
+			*Size = sizeof(ClockSample);
+			return (const uint8_t*)&ClockSample;
+		case DIAG_BLOCK_USB_INTERRUPTS:
+			*Size = sizeof(USBInterrupts_Stats);
+			return (const uint8_t*)USBInterrupts_Stats;
+#if defined(ENABLE_USB_MIDI)
+		case DIAG_BLOCK_MIDI_STREAM:
+			*Size = sizeof(MIDIStream_Dropped);
+			return (const uint8_t*)&MIDIStream_Dropped;
+#endif
+	}
+
+	*Size = 0;
+	return NULL;
+}
+
+/** Takes a new clock synchronisation sample. Runs from USB_COM_vect with interrupts enabled, so the
+ *  start of frame interrupt can preempt it and the frame fields are copied with interrupts off.
+ */
+static void Diagnostics_SampleClock(void)
+{
+	ClockSample.Time = Scheduler_GetTime();
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ClockSample.SofFrame = SofFrame;
+		ClockSample.SofTime  = SofTime;
+	}
+
+	/* Without start of frame events, report the current frame instead */
+	if (!(ClockSample.SofTime))
+	  ClockSample.SofFrame = USB_Device_GetFrameNumber();
+}
+
+/** Records the time of a USB start of frame. The host controller sends these exactly 1ms apart
+ *  on its own clock, which gives the host a low-noise reference for the timebase drift. Called
+ *  from the start of frame event when \ref ENABLE_CLOCK_SYNC is set.
+ */
+void Diagnostics_StartOfFrame(void)
+{
+	SofTime  = Scheduler_GetTime();
+	SofFrame = USB_Device_GetFrameNumber();
+}
+
+/** Processes a SET_REPORT (Feature) request from the host.
+ *
+ *  \param[in] Report  Report data, \ref DIAG_REPORT_SIZE bytes.
+ */
+void Diagnostics_ProcessCommand(const uint8_t* const Report)
+{
+	switch (Report[0])
+	{
+		case DIAG_CMD_SELECT:
+			SelectedBlock  = Report[1];
+			SelectedOffset = Report[2] | ((uint16_t)Report[3] << 8);
+			break;
+		case DIAG_CMD_RECORDER_FREEZE:
+			FlightRecorder_Freeze(FR_CAUSE_HOST);
+			break;
+		case DIAG_CMD_RECORDER_ARM:
+			FlightRecorder_Arm(Report[1]);
+			break;
+	}
+}
+
+/** Creates the response to a GET_REPORT (Feature) request: the selected block ID, the read
+ *  offset and up to \ref DIAG_CHUNK_SIZE bytes of block data, zero padded past the end of the
+ *  block. The read offset is advanced so that consecutive requests stream the whole block.
+ *
+ *  \param[out] Report  Report data, \ref DIAG_REPORT_SIZE bytes.
+ */
+void Diagnostics_CreateReport(uint8_t* const Report)
+{
+	uint16_t       Size;
+	const uint8_t* Block = Diagnostics_GetBlock(SelectedBlock, &Size);
+
+	if (SelectedBlock == DIAG_BLOCK_CLOCK)
+	{
+		if (SelectedOffset >= Size)
+		  SelectedOffset = 0;
+
+		if (SelectedOffset == 0)
+		  Diagnostics_SampleClock();
+	}
+
+	memset(Report, 0, DIAG_REPORT_SIZE);
+
+	Report[0] = SelectedBlock;
+	Report[1] = (SelectedOffset & 0xFF);
+	Report[2] = (SelectedOffset >> 8);
+
+	for (uint8_t i = 0; i < DIAG_CHUNK_SIZE; i++)
+	{
+		if (SelectedOffset >= Size)
+		  break;
+
+		Report[3 + i] = Block[SelectedOffset++];
+	}
+}
@@ -0,0 +1,91 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Header file for Diagnostics.c.
+ *
+ *  Diagnostic data is read through the 8-byte vendor feature report already present in the
+ *  HID report descriptor. The host sends a SET_REPORT (Feature) with a command, then reads
+ *  the selected data with GET_REPORT (Feature) requests, each of which returns the next
+ *  \ref DIAG_CHUNK_SIZE bytes of the selected block and advances the read offset.
+ */
+
+#ifndef _DIAGNOSTICS_H_
+#define _DIAGNOSTICS_H_
+
+	/* Includes: */
+		#include <stdint.h>
+		#include <stdbool.h>
+
+	/* Macros: */
+		/** Size in bytes of the vendor feature report, as declared in the HID report descriptor. */
+		#define DIAG_REPORT_SIZE                 8
+
+		/** Number of block data bytes carried by each GET_REPORT (Feature) response. */
+		#define DIAG_CHUNK_SIZE                  (DIAG_REPORT_SIZE - 3)
+
+	/* Enums: */
+		/** Enum for the commands accepted in byte 0 of a SET_REPORT (Feature) request. */
+		enum Diagnostics_Command_t
+		{
+			DIAG_CMD_SELECT          = 0x01, /**< Select a block for reading: [cmd, block, offset low, offset high] */
+			DIAG_CMD_RECORDER_FREEZE = 0x02, /**< Stop the flight recorder: [cmd] */
+			DIAG_CMD_RECORDER_ARM    = 0x03, /**< Resume the flight recorder: [cmd, trigger note or 0xFF] */
+		};
+
+		/** Enum for the diagnostic blocks that can be read out. */
+		enum Diagnostics_Block_t
+		{
+			DIAG_BLOCK_BOOT_TRACE      = 0x00, /**< \ref BootTrace_t */
+			DIAG_BLOCK_SCHEDULER_STATS = 0x01, /**< \ref Scheduler_Stats_t */
+			DIAG_BLOCK_SCHEDULER_TASKS = 0x02, /**< Array of \ref Scheduler_Task_t, in priority order */
+			DIAG_BLOCK_MIDI_INPUT      = 0x03, /**< Array of \ref MIDIInput_Stats_t, one per input port */
+			DIAG_BLOCK_FLIGHT_RECORDER = 0x04, /**< \ref FlightRecorder_t, empty if the recorder is not enabled */
+			DIAG_BLOCK_MIDI_THRU       = 0x05, /**< \ref MIDIThru_Stats_t, empty if THRU is not enabled */
+			DIAG_BLOCK_CLOCK           = 0x06, /**< \ref ClockSample_t, sampled afresh each time it is read from offset zero */
+			DIAG_BLOCK_USB_INTERRUPTS  = 0x07, /**< Array of \ref USBInterrupts_Stats_t, one per USB interrupt vector */
+			DIAG_BLOCK_MIDI_STREAM     = 0x08, /**< \ref MIDIStream_Dropped, empty if USB-MIDI is not enabled */
+		};
+
+	/* Type Defines: */
+		/** Type define for the boot trace. All times are in timebase ticks (0.5us) since reset. */
+		typedef struct
+		{
+			uint8_t  ResetCause; /**< MCUSR value at reset. */
+			uint8_t  Configurations; /**< Number of SET_CONFIGURATION requests since reset. */
+			uint32_t Attach; /**< USB interface initialised and attached to the bus. */
+			uint32_t Configured; /**< Latest SET_CONFIGURATION from the host. */
+			uint32_t FirstReport; /**< First non-idle report written after the latest configuration, zero until then. */
+		} BootTrace_t;
+
+		/** Type define for a clock synchronisation sample. Reading the block from offset zero takes a new
+		 *  sample, and the read offset wraps back to zero after the last byte, so the host can keep
+		 *  sampling with GET_REPORT requests alone. \c Time is in the first chunk, so the round trip of
+		 *  that one request brackets it.
+		 */
+		typedef struct
+		{
+			uint32_t Time; /**< Timebase time the request was handled. */
+			uint16_t SofFrame; /**< USB frame number of the last start of frame. */
+			uint32_t SofTime; /**< Timebase time of that start of frame, zero unless \ref ENABLE_CLOCK_SYNC is set. */
+		} ClockSample_t;
+
+	/* External Variables: */
+		extern BootTrace_t BootTrace;
+
+	/* Function Prototypes: */
+		void Diagnostics_ProcessCommand(const uint8_t* const Report);
+		void Diagnostics_CreateReport(uint8_t* const Report);
+		void Diagnostics_StartOfFrame(void);
+
+#endif
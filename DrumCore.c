@@ -0,0 +1,157 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+#include "DrumCore.h"
+
+_Static_assert(sizeof(HIDReport_t) == 27, "HIDReport_t must match the HID report descriptor");
+
+/*
+00 00 08 7F 7F 7F 7F 00 00 00 00 00 00 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Nothing
+20 00 08 7F 7F 7F 7F 00 00 00 00 00 00 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Kick 2 Black
+10 00 08 7F 7F 7F 7F 00 00 00 00 00 00 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Kick 1 Orange
+04 04 08 7F 7F 7F 7F 00 00 00 00 00 FF 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Red / 1
+08 04 08 7F 7F 7F 7F 00 00 00 00 FF 00 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Yellow / 2
+01 04 08 7F 7F 7F 7F 00 00 00 00 00 00 00 FF 00 00 00 00 02 00 02 00 02 00 02 00 Blue / 3
+02 04 08 7F 7F 7F 7F 00 00 00 00 00 00 FF 00 00 00 00 00 02 00 02 00 02 00 02 00 Green / 4
+      XX Hat = 08 centered, clockwise 00 up, 01 up/right, 02 right, etc
+   XX buttons = 08 cymbal, 04 drum hit, 01 minus, 02 plus, 10 home 
+XX buttons = 01 1, 08 2, 02 A, 04 B
+10 04 08 7F 7F 7F 7F 00 00 00 00 00 00 00 00 66 00 00 00 02 00 02 00 02 00 02 00
+08 04 08 7F 7F 7F 7F 00 00 00 00 00 00 00 6B
+02 08 08 7F 7F 7F 7F 00 00 00 00 00 00 FF 00 00 00 00 00 02 00 02 00 02 00 02 00
+*/
+
+/*
+Hex: 0x2c | Decimal: 44 | MIDI Note: G#2
+Hex: 0x24 | Decimal: 36 | MIDI Note: C2
+Hex: 0x31 | Decimal: 49 | MIDI Note: C#3
+Hex: 0x2e | Decimal: 46 | MIDI Note: A#2
+Hex: 0x33 | Decimal: 51 | MIDI Note: D#3
+Hex: 0x2d | Decimal: 45 | MIDI Note: A2
+Hex: 0x2b | Decimal: 43 | MIDI Note: G2
+Hex: 0x26 | Decimal: 38 | MIDI Note: D2
+Hex: 0x30 | Decimal: 48 | MIDI Note: C3
+*/
+uint8_t map_note(uint8_t x) {
+    switch (x) {
+        case 0x2C: return PEDAL; 	// Pedal         
+        case 0x24: return KICK; 	// Kick
+		case 0x31: return CYMBAL | 0;	// Blue Cymbal 
+        case 0x2E: return CYMBAL | 3;	// Yellow Cymbal
+		case 0x33: return CYMBAL | 1;	// Green Cymbal
+        case 0x2D: return 0;		// Blue
+        case 0x2B: return 1;		// Green
+	    case 0x26: return 2;		// Red
+        case 0x30: return 3;		// Yellow
+        default: return NO_MAPPING;
+    }
+}
+
+const HIDReport_t default_report = {
+    .button = {0x00, 0x00},
+    .hat    = 0x08,
+    .X      = 0x7F,
+    .Y      = 0x7F,
+    .Z      = 0x7F,
+    .Rz     = 0x7F,
+    .vendor8 = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
+                0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .vendor16 = {0x0002, 0x0002, 0x0002, 0x0002}
+};
+
+// Helper: get expected MIDI message length from status byte
+static uint8_t midi_message_length(uint8_t status) {
+    if ((status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0)
+        return 2;  // Program Change & Channel Pressure
+    else
+        return 3;  // Note on/off, Control Change, etc., and a SysEx header
+}
+
+// Feed one byte to the parser, returns true when parser->buffer holds a complete message
+bool midi_parse_byte(MidiParser_t *parser, uint8_t byte) {
+    if (byte >= 0xF8) {
+        // Realtime bytes may appear anywhere and must not disturb the message in progress
+        return false;
+    }
+
+    if (byte & 0x80) {
+        // Status byte detected: start new message
+        parser->index = 0;
+        parser->buffer[parser->index++] = byte;
+        // System common bytes cancel running status; only a SysEx start is kept, for its header
+        parser->status = (byte <= 0xF0) ? byte : 0;
+        return false;
+    }
+
+    if (parser->status == 0 || parser->index >= MIDI_SIZE) {
+        // No status to run on, or the body of a SysEx whose header was already returned
+        return false;
+    }
+
+    parser->buffer[parser->index++] = byte;
+
+    // Check if message is complete
+    if (parser->index >= midi_message_length(parser->status)) {
+        // Keep the status byte for running status; a SysEx returns F0 and its first two data
+        // bytes once, and the rest up to F7 is skipped
+        if (parser->status != 0xF0)
+            parser->index = 1;
+        return true;
+    }
+
+    return false;
+}
+
+// Apply one complete MIDI message to the report state, returns DrumCore_Result_t flags
+uint8_t report_apply_message(HIDReport_t *report, const uint8_t *msg) {
+    uint8_t type = msg[0] & 0xF0;   // upper nibble = message type
+    uint8_t note = msg[1];
+    uint8_t velocity = msg[2];
+    report->vendor8[9] = msg[0];
+    report->vendor8[10] = msg[1];
+    report->vendor8[11] = msg[2];
+
+    if (type == NOTE_OFF || (type == NOTE_ON && velocity == 0)) {
+        uint8_t offset = map_note(note);
+        if (offset == NO_MAPPING) {
+            return REPORT_CHANGED;
+        } else if (offset == PEDAL) {
+            report->button[1] &= ~0x02;
+            return REPORT_CHANGED;
+        } else if (offset == KICK) {
+            report->button[0] &= ~0x10;
+            return REPORT_CHANGED;
+        } else {
+            report->button[0] &= ~(1 << (offset & ~CYMBAL));
+            report->vendor8[5+(offset & ~CYMBAL)] = 0;
+            return REPORT_CHANGED | REPORT_PAD_OFF;
+        }
+    } else if (type == NOTE_ON) {
+        uint8_t offset = map_note(note);
+        if (offset == NO_MAPPING) {
+            return REPORT_CHANGED;
+        } else if (offset == PEDAL) {
+            report->button[1] |= 0x02;
+            return REPORT_CHANGED;
+        } else if (offset == KICK) {
+            report->button[0] |= 0x10;
+            return REPORT_CHANGED;
+        } else {
+            report->button[0] |= (1 << (offset & ~CYMBAL));
+            report->button[1] = (offset & CYMBAL) ? 0x08 : 0x04;
+            report->vendor8[5+(offset & ~CYMBAL)] = velocity;
+            return REPORT_CHANGED | REPORT_PAD_ON;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Header file for DrumCore.c.
+ *
+ *  Portable MIDI-to-report core shared by the firmware and the Linux daemon (tools/rbmidid).
+ *  It depends only on the C standard headers, never allocates, and keeps all state in the
+ *  structures passed to it, so one process can run several kits side by side.
+ */
+
+#ifndef _DRUM_CORE_H_
+#define _DRUM_CORE_H_
+
+	/* Includes: */
+		#include <stdint.h>
+		#include <stdbool.h>
+
+	/* Macros: */
+		#define MIDI_SIZE 3  // Max message size we expect
+		#define NOTE_OFF       0x80
+		#define NOTE_ON        0x90
+		#define CONTROL_CHANGE 0xB0
+
+		// map_note() results
+		#define PEDAL  0xA0
+		#define KICK   0xA1
+		#define CYMBAL 0xB0
+		#define NO_MAPPING 0xFF
+
+	/* Enums: */
+		/** Flags returned by report_apply_message(). */
+		enum DrumCore_Result_t
+		{
+			REPORT_CHANGED = (1 << 0), /**< A report should be queued for the host. */
+			REPORT_PAD_ON  = (1 << 1), /**< A pad or cymbal was hit. */
+			REPORT_PAD_OFF = (1 << 2), /**< A pad or cymbal was released. */
+		};
+
+	/* Type Defines: */
+		/** Rock Band drum HID report, little endian and unpadded on every target. */
+		typedef struct __attribute__((packed)) {
+			uint8_t button[2];
+			uint8_t hat;
+			uint8_t X, Y, Z, Rz;
+			uint8_t vendor8[12];
+			uint16_t vendor16[4];
+		} HIDReport_t;
+
+		/** MIDI byte stream parser state. */
+		typedef struct {
+			uint8_t buffer[MIDI_SIZE];
+			uint8_t index;
+			uint8_t status;  // Last status byte (running status)
+		} MidiParser_t;
+
+	/* External Variables: */
+		extern const HIDReport_t default_report;
+
+	/* Function Prototypes: */
+		uint8_t map_note(uint8_t x);
+		bool midi_parse_byte(MidiParser_t *parser, uint8_t byte);
+		uint8_t report_apply_message(HIDReport_t *report, const uint8_t *msg);
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Flight recorder. A hit and its release take about six records (two parsed messages, two report
+ *  pushes and two reports sent) plus one or two time records, so the default 128 records hold
+ *  roughly the last 16 hits, a few seconds of play. Every update to the ring is made with
+ *  interrupts disabled, as the host freezes and re-arms it from USB_COM_vect and the timebase
+ *  overflow interrupt writes the time records.
+ */
+
+#include "FlightRecorder.h"
+#include "DrumCore.h"
+#include "Scheduler.h"
+
+#if defined(ENABLE_FLIGHT_RECORDER)
+
+FlightRecorder_t FlightRecorder =
+	{
+		.TriggerNote = FLIGHT_RECORDER_TRIGGER_NOTE,
+	};
+
+/** Writes a time record for the records since the previous one, if there are any. Called from
+ *  the Timer1 overflow interrupt before the upper half of the timebase is incremented.
+ *
+ *  \param[in] Upper  Upper half of the timebase for the period that just ended.
+ */
+void FlightRecorder_TimebaseOverflow(const uint16_t Upper)
+{
+	if (FlightRecorder.Frozen || !(FlightRecorder.Untimed))
+	  return;
+
+	FlightRecorder.Untimed = false;
+	FlightRecorder_Write(FR_EVT_TIME, TCNT1, (Upper & 0xFF), (Upper >> 8), 0);
+}
+
+/** Freezes the recorder if a parsed message is one of the triggers: a note on for the trigger
+ *  note, or the start of the SysEx F0 7D \ref FLIGHT_RECORDER_SYSEX_ID. The message itself should
+ *  already have been recorded so that it is the last record in the ring.
+ *
+ *  \param[in] Message  Complete message as returned by the MIDI parser.
+ */
+void FlightRecorder_CheckMessage(const uint8_t* const Message)
+{
+	if (((Message[0] & 0xF0) == NOTE_ON) && (Message[1] == FlightRecorder.TriggerNote) && Message[2])
+	  FlightRecorder_Freeze(FR_CAUSE_NOTE);
+	else if ((Message[0] == 0xF0) && (Message[1] == FLIGHT_RECORDER_SYSEX_MANUFACTURER) &&
+	         (Message[2] == FLIGHT_RECORDER_SYSEX_ID))
+	  FlightRecorder_Freeze(FR_CAUSE_SYSEX);
+}
+
+/** Stops recording. The first freeze wins; later ones are ignored until the recorder is re-armed.
+ *
+ *  \param[in] Cause  Reason for the freeze, a value from \ref FlightRecorder_Cause_t.
+ */
+void FlightRecorder_Freeze(const uint8_t Cause)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (!(FlightRecorder.Frozen))
+		{
+			/* Close the last period so that every record is followed by its time record */
+			if (FlightRecorder.Untimed)
+			{
+				uint16_t Upper = Scheduler_TimebaseOverflows;
+
+				FlightRecorder.Untimed = false;
+				FlightRecorder_Write(FR_EVT_TIME, TCNT1, (Upper & 0xFF), (Upper >> 8), 0);
+			}
+
+			FlightRecorder.FreezeCause = Cause;
+			FlightRecorder.FreezeTime  = Scheduler_GetTime();
+			FlightRecorder.Frozen      = true;
+		}
+	}
+}
+
+/** Resumes recording after a freeze. Records already in the ring are kept and age out as new
+ *  ones are written.
+ *
+ *  \param[in] TriggerNote  Note number that freezes the recorder, 0xFF for none.
+ */
+void FlightRecorder_Arm(const uint8_t TriggerNote)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		FlightRecorder.TriggerNote = TriggerNote;
+		FlightRecorder.FreezeCause = FR_CAUSE_NONE;
+		FlightRecorder.Frozen      = false;
+	}
+}
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Header file for FlightRecorder.c.
+ *
+ *  The flight recorder keeps the most recent pipeline events in a RAM ring so that a missed note
+ *  can be investigated after the fact. Recording stops when the ring is frozen, by a host command,
+ *  a trigger note or a trigger SysEx, and the ring is then read out through the diagnostics
+ *  channel as \ref DIAG_BLOCK_FLIGHT_RECORDER.
+ *
+ *  The ring is written from the main loop tasks (every record), from the Timer1 overflow interrupt
+ *  (time records) and from USB_COM_vect (freeze and re-arm from the host, which runs with
+ *  interrupts enabled). All of them update it with interrupts disabled. The records are only
+ *  readable while the ring is frozen, so the host never sees one half written.
+ */
+
+#ifndef _FLIGHT_RECORDER_H_
+#define _FLIGHT_RECORDER_H_
+
+	/* Includes: */
+		#include <stdint.h>
+		#include <stdbool.h>
+		#include <avr/io.h>
+		#include <util/atomic.h>
+
+		#include "Config/AppConfig.h"
+
+	/* Macros: */
+		/** Manufacturer ID of the trigger SysEx, the ID reserved for non-commercial use. */
+		#define FLIGHT_RECORDER_SYSEX_MANUFACTURER  0x7D
+
+	/* Enums: */
+		/** Enum for the record types, in the upper nibble of \ref FlightRecord_t::Event. The lower
+		 *  nibble holds the MIDI input port for input events and is zero otherwise.
+		 */
+		enum FlightRecorder_Event_t
+		{
+			FR_EVT_MIDI           = 0x10, /**< Message parsed and queued. Data: the message bytes. */
+			FR_EVT_RX_LOST        = 0x20, /**< Input error counters changed. Data: overruns (16-bit LE), framing errors (low byte). */
+			FR_EVT_REPORT_QUEUED  = 0x30, /**< Report pushed to the report queue. Data: queue depth, button[0], button[1]. */
+			FR_EVT_REPORT_DROPPED = 0x40, /**< Report pushed to a full report queue, discarding the oldest. Data: as queued. */
+			FR_EVT_REPORT_SENT    = 0x50, /**< Queued report written to HID_IN_EPADDR. Data: remaining depth, button[0], button[1]. */
+			FR_EVT_TIME           = 0x60, /**< Records since the previous time record were written while the upper half of the timebase held Data[0..1] (16-bit LE). */
+		};
+
+		/** Enum for the reasons the recorder was frozen. */
+		enum FlightRecorder_Cause_t
+		{
+			FR_CAUSE_NONE  = 0x00, /**< Recording. */
+			FR_CAUSE_HOST  = 0x01, /**< \ref DIAG_CMD_RECORDER_FREEZE from the host. */
+			FR_CAUSE_NOTE  = 0x02, /**< Note on for the trigger note. */
+			FR_CAUSE_SYSEX = 0x03, /**< SysEx F0 7D \ref FLIGHT_RECORDER_SYSEX_ID. */
+		};
+
+	/* Type Defines: */
+		/** Type define for a flight recorder record. Only the lower half of the timebase is stored;
+		 *  every record is followed in the ring by an \ref FR_EVT_TIME record holding the upper half,
+		 *  written at the next timebase overflow or at the freeze, whichever comes first.
+		 */
+		typedef struct
+		{
+			uint16_t Time; /**< Lower 16 bits of the timebase time of the event. */
+			uint8_t  Event; /**< Record type, a value from \ref FlightRecorder_Event_t plus the port, zero for a never written record. */
+			uint8_t  Data[3]; /**< Event specific data. */
+		} FlightRecord_t;
+
+		/** Type define for the flight recorder, read out as a whole by the host. */
+		typedef struct
+		{
+			uint8_t           Head; /**< Index of the next record to write, which is also the oldest record. */
+			volatile bool     Frozen; /**< Recording is stopped. */
+			uint8_t           FreezeCause; /**< Why recording stopped, a value from \ref FlightRecorder_Cause_t. */
+			uint8_t           TriggerNote; /**< Note number that freezes the recorder, 0xFF for none. */
+			uint32_t          FreezeTime; /**< Timebase time recording stopped. */
+			bool              Untimed; /**< Records have been written since the last \ref FR_EVT_TIME record. */
+			FlightRecord_t    Records[FLIGHT_RECORDER_RECORDS];
+		} FlightRecorder_t;
+
+	/* External Variables: */
+		#if defined(ENABLE_FLIGHT_RECORDER)
+		extern FlightRecorder_t FlightRecorder;
+		#endif
+
+	/* Inline Functions: */
+		#if defined(ENABLE_FLIGHT_RECORDER)
+		/** Appends a record to the ring, overwriting the oldest. Must be called with interrupts disabled. */
+		static inline void FlightRecorder_Write(const uint8_t Event,
+		                                        const uint16_t Time,
+		                                        const uint8_t Data0,
+		                                        const uint8_t Data1,
+		                                        const uint8_t Data2)
+		{
+			FlightRecord_t* Record = &FlightRecorder.Records[FlightRecorder.Head];
+			FlightRecorder.Head = (FlightRecorder.Head + 1) & (FLIGHT_RECORDER_RECORDS - 1);
+
+			Record->Time    = Time;
+			Record->Event   = Event;
+			Record->Data[0] = Data0;
+			Record->Data[1] = Data1;
+			Record->Data[2] = Data2;
+		}
+
+		/** Records an event unless the recorder is frozen. Inlined into the main loop tasks, where it
+		 *  runs for every parsed MIDI message and every report queued and sent: one 16-bit timer read
+		 *  and six stores with interrupts disabled, about 40 cycles by instruction count.
+		 *
+		 *  \param[in] Event  Record type, a value from \ref FlightRecorder_Event_t plus the port.
+		 *  \param[in] Data0  First event specific data byte.
+		 *  \param[in] Data1  Second event specific data byte.
+		 *  \param[in] Data2  Third event specific data byte.
+		 */
+		static inline void FlightRecorder_Record(const uint8_t Event,
+		                                         const uint8_t Data0,
+		                                         const uint8_t Data1,
+		                                         const uint8_t Data2)
+		{
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+			{
+				if (!(FlightRecorder.Frozen))
+				{
+					uint16_t Time = TCNT1;
+
+					/* The timer has wrapped but the overflow interrupt has not run yet, so the time
+					 * record that follows will still name the old upper half; stamp the end of it
+					 */
+					if (TIFR1 & (1 << TOV1))
+					  Time = 0xFFFF;
+
+					FlightRecorder.Untimed = true;
+					FlightRecorder_Write(Event, Time, Data0, Data1, Data2);
+				}
+			}
+		}
+		#endif
+
+	/* Function Prototypes: */
+		#if defined(ENABLE_FLIGHT_RECORDER)
+		void FlightRecorder_TimebaseOverflow(const uint16_t Upper);
+		void FlightRecorder_CheckMessage(const uint8_t* const Message);
+		void FlightRecorder_Freeze(const uint8_t Cause);
+		void FlightRecorder_Arm(const uint8_t TriggerNote);
+		#else
+		static inline void FlightRecorder_TimebaseOverflow(const uint16_t Upper) {}
+		static inline void FlightRecorder_Record(const uint8_t Event,
+		                                         const uint8_t Data0,
+		                                         const uint8_t Data1,
+		                                         const uint8_t Data2) {}
+		static inline void FlightRecorder_CheckMessage(const uint8_t* const Message) {}
+		static inline void FlightRecorder_Freeze(const uint8_t Cause) {}
+		static inline void FlightRecorder_Arm(const uint8_t TriggerNote) {}
+		#endif
+
+#endif
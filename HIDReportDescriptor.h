@@ -0,0 +1,92 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Rock Band drum controller HID report descriptor, shared by the firmware (Descriptors.c) and
+ *  the Linux daemon (tools/rbmidid) so both present byte-identical descriptors. The items are
+ *  written with LUFA's HID_RI_* macros from HIDReportData.h, which the includer must provide.
+ */
+
+#ifndef _HID_REPORT_DESCRIPTOR_H_
+#define _HID_REPORT_DESCRIPTOR_H_
+
+	/* Macros: */
+		/** Items of the 27-byte gamepad report described by \c HIDReport_t in DrumCore.h. */
+		#define ROCKBAND_HID_REPORT_DESCRIPTOR \
+			    HID_RI_USAGE_PAGE(8, 0x01),            /* Generic Desktop */                                  \
+			    HID_RI_USAGE(8, 0x05),                 /* Game Pad */                                         \
+			    HID_RI_COLLECTION(8, 0x01),            /* Application */                                      \
+			        HID_RI_LOGICAL_MINIMUM(8, 0x00),                                                          \
+			        HID_RI_LOGICAL_MAXIMUM(8, 0x01),                                                          \
+			        HID_RI_PHYSICAL_MINIMUM(8, 0x00),                                                         \
+			        HID_RI_PHYSICAL_MAXIMUM(8, 0x01),                                                         \
+			        HID_RI_REPORT_SIZE(8, 0x01),                                                              \
+			        HID_RI_REPORT_COUNT(8, 0x0D),                                                             \
+			        HID_RI_USAGE_PAGE(8, 0x09),        /* Button */                                           \
+			        HID_RI_USAGE_MINIMUM(8, 0x01),                                                            \
+			        HID_RI_USAGE_MAXIMUM(8, 0x0D),                                                            \
+			        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),                      \
+			        HID_RI_REPORT_COUNT(8, 0x03),                                                             \
+			        HID_RI_INPUT(8, HID_IOF_CONSTANT),                                                        \
+			        HID_RI_USAGE_PAGE(8, 0x01),        /* Generic Desktop */                                  \
+			        HID_RI_LOGICAL_MAXIMUM(8, 0x07),                                                          \
+			        HID_RI_PHYSICAL_MAXIMUM(16, 0x013B),                                                      \
+			        HID_RI_REPORT_SIZE(8, 0x04),                                                              \
+			        HID_RI_REPORT_COUNT(8, 0x01),                                                             \
+			        HID_RI_UNIT(8, 0x14),              /* Rotation (Eng. Pos) */                              \
+			        HID_RI_USAGE(8, 0x39),             /* Hat switch */                                       \
+			        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NULLSTATE),  \
+			        HID_RI_UNIT(8, 0x00),                                                                     \
+			        HID_RI_REPORT_COUNT(8, 0x01),                                                             \
+			        HID_RI_INPUT(8, HID_IOF_CONSTANT),                                                        \
+			        HID_RI_LOGICAL_MAXIMUM(16, 0x00FF),                                                       \
+			        HID_RI_PHYSICAL_MAXIMUM(16, 0x00FF),                                                      \
+			        HID_RI_USAGE(8, 0x30),             /* X */                                                \
+			        HID_RI_USAGE(8, 0x31),             /* Y */                                                \
+			        HID_RI_USAGE(8, 0x32),             /* Z */                                                \
+			        HID_RI_USAGE(8, 0x35),             /* Rz */                                               \
+			        HID_RI_REPORT_SIZE(8, 0x08),                                                              \
+			        HID_RI_REPORT_COUNT(8, 0x04),                                                             \
+			        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),                      \
+			        HID_RI_USAGE_PAGE(16, 0xFF00),     /* Vendor-defined */                                   \
+			        HID_RI_USAGE(8, 0x20),                                                                    \
+			        HID_RI_USAGE(8, 0x21),                                                                    \
+			        HID_RI_USAGE(8, 0x22),                                                                    \
+			        HID_RI_USAGE(8, 0x23),                                                                    \
+			        HID_RI_USAGE(8, 0x24),                                                                    \
+			        HID_RI_USAGE(8, 0x25),                                                                    \
+			        HID_RI_USAGE(8, 0x26),                                                                    \
+			        HID_RI_USAGE(8, 0x27),                                                                    \
+			        HID_RI_USAGE(8, 0x28),                                                                    \
+			        HID_RI_USAGE(8, 0x29),                                                                    \
+			        HID_RI_USAGE(8, 0x2A),                                                                    \
+			        HID_RI_USAGE(8, 0x2B),                                                                    \
+			        HID_RI_REPORT_COUNT(8, 0x0C),                                                             \
+			        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),                      \
+			        HID_RI_USAGE(16, 0x2621),          /* Vendor-defined */                                   \
+			        HID_RI_REPORT_COUNT(8, 0x08),                                                             \
+			        HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),                    \
+			        HID_RI_USAGE(16, 0x2621),          /* Vendor-defined */                                   \
+			        HID_RI_OUTPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),                     \
+			        HID_RI_LOGICAL_MAXIMUM(16, 0x03FF),                                                       \
+			        HID_RI_PHYSICAL_MAXIMUM(16, 0x03FF),                                                      \
+			        HID_RI_USAGE(8, 0x2C),                                                                    \
+			        HID_RI_USAGE(8, 0x2D),                                                                    \
+			        HID_RI_USAGE(8, 0x2E),                                                                    \
+			        HID_RI_USAGE(8, 0x2F),                                                                    \
+			        HID_RI_REPORT_SIZE(8, 0x10),                                                              \
+			        HID_RI_REPORT_COUNT(8, 0x04),                                                             \
+			        HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),                      \
+			    HID_RI_END_COLLECTION(0)
+
+#endif
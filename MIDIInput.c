@@ -0,0 +1,280 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  MIDI input ports. Each port has its own receive ring of timestamped bytes filled from its
+ *  interrupt; the UART task pops bytes from all ports in timestamp order.
+ *
+ *  The second port is a receive-only software UART on ICP1. Timer1 captures the time of every
+ *  edge on the line, alternating the capture edge, and each byte is rebuilt from the distance
+ *  between edges: between two edges the line held one level for a whole number of bit times.
+ *  An output compare on Timer1 channel B closes the frame in the middle of the stop bit, as the
+ *  trailing high bits produce no edge. Nothing here waits on the line, so the USART1 interrupt is
+ *  never held off by more than one short capture interrupt.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "MIDIInput.h"
+#include "MIDIThru.h"
+
+/** Number of bits in a frame: start bit, eight data bits and stop bit. */
+#define MIDI_FRAME_BITS       10
+
+/** Offset of the middle of the stop bit from the start bit falling edge, in timebase ticks. */
+#define MIDI_FRAME_END_TICKS  ((MIDI_FRAME_BITS * MIDI_BIT_TICKS) - (MIDI_BIT_TICKS / 2))
+
+/** Type define for a port receive ring, filled by the port interrupt and drained by \ref MIDIInput_Pop(). */
+typedef struct
+{
+	volatile uint8_t  Bytes[UART_RX_RING_SIZE];
+	volatile uint16_t Stamps[UART_RX_RING_SIZE];
+	volatile uint8_t  Head;
+	volatile uint8_t  Tail;
+} MIDIInput_Ring_t;
+
+MIDIInput_Stats_t MIDIInput_Stats[MIDI_INPUT_PORTS];
+
+static MIDIInput_Ring_t Rings[MIDI_INPUT_PORTS];
+
+/** Records the run time of a receive interrupt, measured from its timestamp. */
+static inline void MIDIInput_RecordIsrTime(const uint8_t Port,
+                                           const uint16_t Stamp)
+{
+	uint16_t Elapsed = TCNT1 - Stamp;
+
+	if (Elapsed > MIDIInput_Stats[Port].WorstIsrTicks)
+	  MIDIInput_Stats[Port].WorstIsrTicks = Elapsed;
+}
+
+/** Adds a received byte to a port ring, counting an overrun if the ring is full. Only called
+ *  from the port interrupts, with a constant port so the ring address folds away.
+ */
+static inline void MIDIInput_Push(const uint8_t Port,
+                                  const uint8_t Data,
+                                  const uint16_t Stamp)
+{
+	MIDIInput_Ring_t* Ring = &Rings[Port];
+	uint8_t           Next = (Ring->Head + 1) & (UART_RX_RING_SIZE - 1);
+
+	if (Next == Ring->Tail)
+	{
+		MIDIInput_Stats[Port].Overruns++;
+		return;
+	}
+
+	Ring->Bytes[Ring->Head]  = Data;
+	Ring->Stamps[Ring->Head] = Stamp;
+	Ring->Head = Next;
+}
+
+ISR(USART1_RX_vect)
+{
+	uint16_t Stamp  = TCNT1;
+	uint8_t  Status = UCSR1A; /* Flags are only valid until UDR1 is read */
+	uint8_t  Data   = UDR1;
+
+	/* The receiver holds two bytes; if the second is already complete, this byte waited a byte time */
+	if (UCSR1A & (1 << RXC1))
+	  MIDIInput_Stats[MIDI_PORT_USART].LateReads++;
+
+	if (Status & (1 << DOR1))
+	  MIDIInput_Stats[MIDI_PORT_USART].Overruns++;
+
+	if (Status & (1 << FE1))
+	{
+		MIDIInput_Stats[MIDI_PORT_USART].FramingErrors++;
+	}
+	else
+	{
+#if defined(ENABLE_MIDI_THRU)
+		/* Forwarded first, so THRU latency does not include the ring push */
+		MIDIThru_Forward(Data, Stamp);
+#endif
+		MIDIInput_Push(MIDI_PORT_USART, Data, Stamp);
+	}
+
+	MIDIInput_RecordIsrTime(MIDI_PORT_USART, Stamp);
+}
+
+#if defined(ENABLE_MIDI_IN2)
+
+/** Software UART frame state, only touched by the Timer1 capture and compare interrupts. */
+static struct
+{
+	bool     Active; /**< A start bit has been seen and the frame is not complete yet. */
+	bool     Level; /**< Line level after the last captured edge. */
+	uint8_t  NextBit; /**< First frame bit not yet known. */
+	uint16_t Start; /**< Capture time of the start bit falling edge. */
+	uint16_t Bits; /**< Frame bits known so far, bit 0 is the start bit. */
+} Frame;
+
+/** Arms input capture for the edge that changes the line from its current level. */
+static inline void MIDIInput_SyncCaptureEdge(void)
+{
+	if (PIND & (1 << PD4))
+	  TCCR1B &= ~(1 << ICES1);
+	else
+	  TCCR1B |=  (1 << ICES1);
+
+	TIFR1 = (1 << ICF1);
+}
+
+/** Completes the current frame: the line held its last level up to the stop bit. */
+static void MIDIInput_FinishFrame(void)
+{
+	if (Frame.Level)
+	  Frame.Bits |= ((1 << MIDI_FRAME_BITS) - (1 << Frame.NextBit));
+
+	Frame.Active = false;
+	TIMSK1 &= ~(1 << OCIE1B);
+
+	if (!(Frame.Bits & (1 << (MIDI_FRAME_BITS - 1))))
+	  MIDIInput_Stats[MIDI_PORT_CAPTURE].FramingErrors++;
+	else
+	  MIDIInput_Push(MIDI_PORT_CAPTURE, (uint8_t)(Frame.Bits >> 1), Frame.Start + MIDI_FRAME_END_TICKS);
+}
+
+ISR(TIMER1_CAPT_vect)
+{
+	uint16_t Stamp  = ICR1;
+	bool     Rising = (TCCR1B & (1 << ICES1));
+
+	/* The capture flag has to be cleared after the edge select is changed */
+	TCCR1B ^= (1 << ICES1);
+	TIFR1   = (1 << ICF1);
+
+	if (Frame.Active)
+	{
+		uint8_t Bit = (uint16_t)(Stamp - Frame.Start + (MIDI_BIT_TICKS / 2)) / MIDI_BIT_TICKS;
+
+		if (Bit < MIDI_FRAME_BITS)
+		{
+			/* A falling edge ends a run of ones from the last edge up to this one */
+			if (!(Rising))
+			  Frame.Bits |= ((1 << Bit) - (1 << Frame.NextBit));
+
+			Frame.NextBit = Bit;
+			Frame.Level   = Rising;
+
+			MIDIInput_RecordIsrTime(MIDI_PORT_CAPTURE, Stamp);
+			return;
+		}
+
+		/* The stop bit compare is overdue; finish the frame before looking at this edge */
+		MIDIInput_FinishFrame();
+	}
+
+	if (!(Rising))
+	{
+		Frame.Active  = true;
+		Frame.Level   = false;
+		Frame.NextBit = 0;
+		Frame.Start   = Stamp;
+		Frame.Bits    = 0;
+
+		OCR1B   = Stamp + MIDI_FRAME_END_TICKS;
+		TIFR1   = (1 << OCF1B);
+		TIMSK1 |= (1 << OCIE1B);
+	}
+
+	MIDIInput_RecordIsrTime(MIDI_PORT_CAPTURE, Stamp);
+}
+
+ISR(TIMER1_COMPB_vect)
+{
+	MIDIInput_FinishFrame();
+
+	/* Re-arm from the actual line level, so a missed edge costs at most one byte */
+	MIDIInput_SyncCaptureEdge();
+}
+
+#endif
+
+/** Configures USART1 for MIDI reception and, if enabled, the input capture port. Must be called
+ *  before global interrupts are enabled, after the timebase has been started.
+ */
+void MIDIInput_Init(void)
+{
+	uint16_t UBRR = (F_CPU / (16UL * MIDI_BAUD)) - 1;
+
+	UBRR1H = (uint8_t)(UBRR >> 8);
+	UBRR1L = (uint8_t)UBRR;
+
+	/* Transmitter enabled too, so the pin idles high; 8 data bits, no parity, 1 stop bit */
+	UCSR1B = (1 << TXEN1) | (1 << RXEN1) | (1 << RXCIE1);
+	UCSR1C = (1 << UCSZ11) | (1 << UCSZ10);
+
+#if defined(ENABLE_MIDI_IN2)
+	/* ICP1 input with pull-up so an unconnected port idles high */
+	DDRD  &= ~(1 << PD4);
+	PORTD |=  (1 << PD4);
+
+	/* Noise canceller delays every edge by the same four cycles, so bit times are unaffected */
+	TCCR1B |= (1 << ICNC1);
+	MIDIInput_SyncCaptureEdge();
+	TIMSK1 |= (1 << ICIE1);
+#endif
+}
+
+/** Returns true if any port has received bytes waiting. */
+bool MIDIInput_IsPending(void)
+{
+	for (uint8_t Port = 0; Port < MIDI_INPUT_PORTS; Port++)
+	{
+		if (Rings[Port].Head != Rings[Port].Tail)
+		  return true;
+	}
+
+	return false;
+}
+
+/** Removes the oldest received byte across all ports. Bytes from one port always come out in
+ *  arrival order; between ports the byte with the earlier stop bit timestamp comes first.
+ *
+ *  \param[out] Byte  Received byte, its port and timestamp.
+ *
+ *  \return Boolean \c true if a byte was returned, \c false if all rings are empty.
+ */
+bool MIDIInput_Pop(MIDIInput_Byte_t* const Byte)
+{
+	uint8_t Port = MIDI_PORT_USART;
+
+#if defined(ENABLE_MIDI_IN2)
+	MIDIInput_Ring_t* Usart   = &Rings[MIDI_PORT_USART];
+	MIDIInput_Ring_t* Capture = &Rings[MIDI_PORT_CAPTURE];
+
+	if (Capture->Head != Capture->Tail)
+	{
+		if ((Usart->Head == Usart->Tail) ||
+		    ((int16_t)(Capture->Stamps[Capture->Tail] - Usart->Stamps[Usart->Tail]) < 0))
+		{
+			Port = MIDI_PORT_CAPTURE;
+		}
+	}
+#endif
+
+	MIDIInput_Ring_t* Ring = &Rings[Port];
+	uint8_t           Tail = Ring->Tail;
+
+	if (Tail == Ring->Head)
+	  return false;
+
+	Byte->Port  = Port;
+	Byte->Data  = Ring->Bytes[Tail];
+	Byte->Stamp = Ring->Stamps[Tail];
+	Ring->Tail  = (Tail + 1) & (UART_RX_RING_SIZE - 1);
+
+	return true;
+}
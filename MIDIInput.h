@@ -0,0 +1,76 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Header file for MIDIInput.c.
+ */
+
+#ifndef _MIDI_INPUT_H_
+#define _MIDI_INPUT_H_
+
+	/* Includes: */
+		#include <stdint.h>
+		#include <stdbool.h>
+
+		#include "Config/AppConfig.h"
+		#include "Scheduler.h"
+
+	/* Macros: */
+		/** MIDI serial bit rate. */
+		#define MIDI_BAUD                        31250UL
+
+		/** Length of one MIDI bit in timebase ticks, 64 at 16MHz. */
+		#define MIDI_BIT_TICKS                   ((F_CPU / TIMEBASE_CYCLES_PER_TICK) / MIDI_BAUD)
+
+		/** Number of input ports: USART1, plus the input capture port if enabled. */
+		#if defined(ENABLE_MIDI_IN2)
+			#define MIDI_INPUT_PORTS             2
+		#else
+			#define MIDI_INPUT_PORTS             1
+		#endif
+
+	/* Enums: */
+		/** Enum for the MIDI input ports. */
+		enum MIDIInput_Port_t
+		{
+			MIDI_PORT_USART    = 0, /**< USART1 receiver on RXD1 (PD2). */
+			MIDI_PORT_CAPTURE  = 1, /**< Timer1 input capture receiver on ICP1 (PD4). */
+		};
+
+	/* Type Defines: */
+		/** Type define for the per-port statistics. The error counters wrap. */
+		typedef struct
+		{
+			uint16_t Overruns; /**< Bytes lost: data overrun in the receiver, or the receive ring was full. */
+			uint16_t FramingErrors; /**< Bytes discarded because the stop bit was not high. */
+			uint16_t WorstIsrTicks; /**< Longest time from an interrupt's timestamp (USART: entry, capture: the edge) to its end. */
+			uint16_t LateReads; /**< USART only: receive interrupts that found the next byte already waiting, so ran at least a byte time late. One more byte of delay overruns the receiver. */
+		} MIDIInput_Stats_t;
+
+		/** Type define for a received byte as returned by \ref MIDIInput_Pop(). */
+		typedef struct
+		{
+			uint8_t  Port; /**< Port the byte arrived on, a value from \ref MIDIInput_Port_t. */
+			uint8_t  Data; /**< Received byte. */
+			uint16_t Stamp; /**< Timebase timestamp taken in the middle of the stop bit. */
+		} MIDIInput_Byte_t;
+
+	/* External Variables: */
+		extern MIDIInput_Stats_t MIDIInput_Stats[MIDI_INPUT_PORTS];
+
+	/* Function Prototypes: */
+		void MIDIInput_Init(void);
+		bool MIDIInput_IsPending(void);
+		bool MIDIInput_Pop(MIDIInput_Byte_t* const Byte);
+
+#endif
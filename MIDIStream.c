@@ -0,0 +1,128 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  USB-MIDI passthrough. Parsed messages are converted to 4-byte USB-MIDI event packets and
+ *  queued; the stream task writes them to the bulk IN endpoint, flushing a bank as soon as it
+ *  holds a full batch and otherwise once per scheduler tick.
+ */
+
+#include "MIDIStream.h"
+
+#if defined(ENABLE_USB_MIDI)
+
+/** Number of packets dropped because the queue was full when the host stopped reading, wraps.
+ *  Read out as \ref DIAG_BLOCK_MIDI_STREAM.
+ */
+uint16_t MIDIStream_Dropped;
+
+static MIDI_EventPacket_t PacketQueue[MIDI_STREAM_QUEUE_SIZE];
+static uint8_t            PacketHead;
+static uint8_t            PacketTail;
+
+/** Returns the number of event packets waiting to be sent. */
+static inline uint8_t MIDIStream_Pending(void)
+{
+	return (uint8_t)(PacketHead - PacketTail) & (MIDI_STREAM_QUEUE_SIZE - 1);
+}
+
+/** Configures the streaming endpoint, called from the configuration changed event.
+ *
+ *  \return Boolean \c true if the endpoint was configured successfully.
+ */
+bool MIDIStream_ConfigureEndpoints(void)
+{
+	PacketHead = PacketTail;
+
+	/* Double banked so one batch can be filled while the host collects the other */
+	return Endpoint_ConfigureEndpoint(MIDI_STREAM_IN_EPADDR, EP_TYPE_BULK, MIDI_STREAM_EPSIZE, 2);
+}
+
+/** Queues a complete channel message for the host. Called from the UART task as each message is
+ *  parsed, so this only packs and queues; nothing touches the endpoint here. System common
+ *  messages and SysEx headers are not forwarded: their packets would need a code index number
+ *  per message length, and the parser does not pass SysEx bodies on.
+ *
+ *  \param[in] Message  Status byte followed by up to two data bytes.
+ */
+void MIDIStream_QueueMessage(const uint8_t* const Message)
+{
+	if (USB_DeviceState != DEVICE_STATE_Configured)
+	  return;
+
+	/* Channel messages only, where the code index number is the command nibble */
+	if ((Message[0] < 0x80) || (Message[0] >= 0xF0))
+	  return;
+
+	uint8_t Next = (PacketHead + 1) & (MIDI_STREAM_QUEUE_SIZE - 1);
+
+	if (Next == PacketTail)
+	{
+		MIDIStream_Dropped++;
+		return;
+	}
+
+	/* Two byte messages (program change, channel pressure) leave Data3 zero, as the class requires */
+	uint8_t Command = (Message[0] & 0xF0);
+	bool    TwoByte = ((Command == 0xC0) || (Command == 0xD0));
+
+	PacketQueue[PacketHead] = (MIDI_EventPacket_t)
+		{
+			.Event = MIDI_EVENT(0, Message[0]),
+			.Data1 = Message[0],
+			.Data2 = Message[1],
+			.Data3 = TwoByte ? 0 : Message[2],
+		};
+
+	PacketHead = Next;
+}
+
+/** Returns true when a full batch is waiting and the endpoint can take it. Partial batches are
+ *  left for the periodic run, so the stream endpoint is written at most once per tick under light
+ *  load and never takes priority over the HID endpoint.
+ */
+bool MIDIStream_Task_IsReady(void)
+{
+	if ((USB_DeviceState != DEVICE_STATE_Configured) || (MIDIStream_Pending() < MIDI_STREAM_BATCH))
+	  return false;
+
+	Endpoint_SelectEndpoint(MIDI_STREAM_IN_EPADDR);
+	return Endpoint_IsINReady();
+}
+
+/** Writes up to one batch of queued event packets into the streaming endpoint bank. */
+void MIDIStream_Task(void)
+{
+	if ((USB_DeviceState != DEVICE_STATE_Configured) || !(MIDIStream_Pending()))
+	  return;
+
+	Endpoint_SelectEndpoint(MIDI_STREAM_IN_EPADDR);
+	if (!(Endpoint_IsINReady()))
+	  return;
+
+	for (uint8_t i = 0; (i < MIDI_STREAM_BATCH) && (PacketTail != PacketHead); i++)
+	{
+		MIDI_EventPacket_t* Packet = &PacketQueue[PacketTail];
+
+		Endpoint_Write_8(Packet->Event);
+		Endpoint_Write_8(Packet->Data1);
+		Endpoint_Write_8(Packet->Data2);
+		Endpoint_Write_8(Packet->Data3);
+
+		PacketTail = (PacketTail + 1) & (MIDI_STREAM_QUEUE_SIZE - 1);
+	}
+
+	Endpoint_ClearIN();
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Header file for MIDIStream.c.
+ */
+
+#ifndef _MIDI_STREAM_H_
+#define _MIDI_STREAM_H_
+
+	/* Includes: */
+		#include <stdint.h>
+		#include <stdbool.h>
+
+		#include "Descriptors.h"
+
+		#include <LUFA/Drivers/USB/USB.h>
+
+	/* Macros: */
+		/** Number of event packets that fill the streaming endpoint bank. */
+		#define MIDI_STREAM_BATCH                (MIDI_STREAM_EPSIZE / sizeof(MIDI_EventPacket_t))
+
+	/* External Variables: */
+		extern uint16_t MIDIStream_Dropped;
+
+	/* Function Prototypes: */
+		bool MIDIStream_ConfigureEndpoints(void);
+		void MIDIStream_QueueMessage(const uint8_t* const Message);
+		bool MIDIStream_Task_IsReady(void);
+		void MIDIStream_Task(void);
+
+#endif
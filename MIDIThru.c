@@ -0,0 +1,60 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Hardware MIDI THRU on USART1 TX (PD3). Every byte received on USART1 is forwarded from the
+ *  receive interrupt itself: straight into the transmitter when it is idle, otherwise through a
+ *  small ring drained by the data register empty interrupt. As both directions run at the same
+ *  bit rate the ring only holds a byte or two, and the main loop is never involved.
+ */
+
+#include <avr/interrupt.h>
+
+#include "MIDIThru.h"
+
+#if defined(ENABLE_MIDI_THRU)
+
+MIDIThru_Stats_t MIDIThru_Stats;
+MIDIThru_Ring_t  MIDIThru_Ring;
+
+/** Note number translation applied to note on, note off and polyphonic aftertouch messages when
+ *  \ref MIDI_THRU_REMAP_NOTES is enabled, indexed by the received note number. Identity by default;
+ *  edit entries to suit the sound module driven from the THRU port.
+ */
+const uint8_t MIDIThru_NoteMap[128] PROGMEM =
+	{
+		  0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,
+		 16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,  28,  29,  30,  31,
+		 32,  33,  34,  35,  36,  37,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47,
+		 48,  49,  50,  51,  52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,
+		 64,  65,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,  76,  77,  78,  79,
+		 80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,  91,  92,  93,  94,  95,
+		 96,  97,  98,  99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111,
+		112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127,
+	};
+
+ISR(USART1_UDRE_vect)
+{
+	MIDIThru_Ring_t* Ring = &MIDIThru_Ring;
+	uint8_t          Tail = Ring->Tail;
+
+	UDR1 = Ring->Bytes[Tail];
+	MIDIThru_RecordDelay(Ring->Stamps[Tail]);
+
+	Ring->Tail = (Tail + 1) & (MIDI_THRU_RING_SIZE - 1);
+
+	if (Ring->Tail == Ring->Head)
+	  UCSR1B &= ~(1 << UDRIE1);
+}
+
+#endif
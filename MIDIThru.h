@@ -0,0 +1,157 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Header file for MIDIThru.c.
+ *
+ *  The forwarding path is inlined into the USART1 receive interrupt, so it is defined here.
+ */
+
+#ifndef _MIDI_THRU_H_
+#define _MIDI_THRU_H_
+
+	/* Includes: */
+		#include <stdint.h>
+		#include <stdbool.h>
+		#include <avr/io.h>
+		#include <avr/pgmspace.h>
+
+		#include "Config/AppConfig.h"
+
+	/* Type Defines: */
+		/** Type define for the THRU statistics. Counters wrap. */
+		typedef struct
+		{
+			uint16_t Forwarded; /**< Bytes loaded into the transmitter. */
+			uint16_t Filtered; /**< Realtime bytes not forwarded. */
+			uint16_t Dropped; /**< Bytes lost because the transmit ring was full. */
+			uint16_t WorstDelayTicks; /**< Longest receive complete to transmit start time, in timebase ticks. */
+		} MIDIThru_Stats_t;
+
+		/** Type define for the transmit ring. Only accessed from the USART1 interrupts, which cannot
+		 *  interrupt each other, so nothing here needs to be volatile.
+		 */
+		typedef struct
+		{
+			uint8_t  Bytes[MIDI_THRU_RING_SIZE];
+			uint16_t Stamps[MIDI_THRU_RING_SIZE]; /**< Receive timestamp of each byte. */
+			uint8_t  Head;
+			uint8_t  Tail;
+			uint8_t  Status; /**< Running status of the forwarded stream, for note remapping. */
+			bool     NoteData; /**< Next data byte is a note number. */
+		} MIDIThru_Ring_t;
+
+	/* External Variables: */
+		#if defined(ENABLE_MIDI_THRU)
+		extern MIDIThru_Stats_t MIDIThru_Stats;
+		extern MIDIThru_Ring_t  MIDIThru_Ring;
+		extern const uint8_t    MIDIThru_NoteMap[128] PROGMEM;
+		#endif
+
+	/* Inline Functions: */
+		#if defined(ENABLE_MIDI_THRU)
+		/** Records the time a byte spent in the adapter, from its receive timestamp until it was loaded
+		 *  into the transmitter. Only called from the USART1 interrupts.
+		 */
+		static inline void MIDIThru_RecordDelay(const uint16_t Stamp)
+		{
+			uint16_t Delay = TCNT1 - Stamp;
+
+			if (Delay > MIDIThru_Stats.WorstDelayTicks)
+			  MIDIThru_Stats.WorstDelayTicks = Delay;
+
+			MIDIThru_Stats.Forwarded++;
+		}
+
+		/** Updates the running status of the forwarded stream and remaps the note number of note on,
+		 *  note off and polyphonic aftertouch messages through \ref MIDIThru_NoteMap.
+		 */
+		static inline uint8_t MIDIThru_RemapNote(uint8_t Data)
+		{
+			MIDIThru_Ring_t* Ring = &MIDIThru_Ring;
+
+			if (Data & 0x80)
+			{
+				/* System common messages cancel running status */
+				Ring->Status   = (Data < 0xF0) ? (Data & 0xF0) : 0;
+				Ring->NoteData = true;
+				return Data;
+			}
+
+			if ((Ring->Status == 0x80) || (Ring->Status == 0x90) || (Ring->Status == 0xA0))
+			{
+				if (Ring->NoteData)
+				  Data = pgm_read_byte(&MIDIThru_NoteMap[Data]);
+
+				Ring->NoteData = !(Ring->NoteData);
+			}
+
+			return Data;
+		}
+
+		/** Forwards a received byte to USART1 TX. Must only be called from the USART1 receive interrupt.
+		 *  The byte goes straight into UDR1 when the transmitter is idle, otherwise it is queued for
+		 *  the data register empty interrupt.
+		 *
+		 *  \param[in] Data   Received byte.
+		 *  \param[in] Stamp  Timebase timestamp of the byte.
+		 */
+		static inline void MIDIThru_Forward(uint8_t Data,
+		                                    const uint16_t Stamp)
+		{
+			MIDIThru_Ring_t* Ring = &MIDIThru_Ring;
+
+			if (Data >= 0xF8)
+			{
+				#if defined(MIDI_THRU_FILTER_REALTIME)
+				MIDIThru_Stats.Filtered++;
+				return;
+				#elif defined(MIDI_THRU_FILTER_ACTIVE_SENSING)
+				if (Data == 0xFE)
+				{
+					MIDIThru_Stats.Filtered++;
+					return;
+				}
+				#endif
+			}
+			#if defined(MIDI_THRU_REMAP_NOTES)
+			else
+			{
+				Data = MIDIThru_RemapNote(Data);
+			}
+			#endif
+
+			if ((Ring->Head == Ring->Tail) && (UCSR1A & (1 << UDRE1)))
+			{
+				UDR1 = Data;
+				MIDIThru_RecordDelay(Stamp);
+				return;
+			}
+
+			uint8_t Next = (Ring->Head + 1) & (MIDI_THRU_RING_SIZE - 1);
+
+			if (Next == Ring->Tail)
+			{
+				MIDIThru_Stats.Dropped++;
+				return;
+			}
+
+			Ring->Bytes[Ring->Head]  = Data;
+			Ring->Stamps[Ring->Head] = Stamp;
+			Ring->Head = Next;
+
+			UCSR1B |= (1 << UDRIE1);
+		}
+		#endif
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Cooperative scheduler and timebase. Timer0 generates the scheduler tick in CTC mode,
+ *  Timer1 free-runs at F_CPU/8 and is extended to 32 bits by its overflow interrupt.
+ */
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+#include "Scheduler.h"
+#include "FlightRecorder.h"
+
+/** Timer0 compare value giving \ref SCHEDULER_TICK_HZ with a /64 prescaler. */
+#define SCHEDULER_TICK_COMPARE  ((F_CPU / 64 / SCHEDULER_TICK_HZ) - 1)
+
+volatile uint8_t  Scheduler_Ticks;
+Scheduler_Stats_t Scheduler_Stats;
+Scheduler_Task_t* Scheduler_Tasks;
+uint8_t           Scheduler_TotalTasks;
+
+volatile uint16_t Scheduler_TimebaseOverflows;
+
+ISR(TIMER0_COMPA_vect)
+{
+	Scheduler_Ticks++;
+}
+
+ISR(TIMER1_OVF_vect)
+{
+	FlightRecorder_TimebaseOverflow(Scheduler_TimebaseOverflows);
+
+	Scheduler_TimebaseOverflows++;
+}
+
+/** Configures Timer0 for the scheduler tick and enables the timebase overflow interrupt. The
+ *  timebase itself is already running from EarlyInit(), and other Timer1 channels may be in use,
+ *  so its registers are only added to. Must be called before global interrupts are enabled.
+ */
+void Scheduler_Init(void)
+{
+	/* Timebase: overflow interrupt extends it to 32 bits */
+	TIMSK1 |= (1 << TOIE1);
+
+	/* Scheduler tick: CTC mode, F_CPU/64 */
+	TCCR0A = (1 << WGM01);
+	TCCR0B = (1 << CS01) | (1 << CS00);
+	OCR0A  = SCHEDULER_TICK_COMPARE;
+	TIMSK0 = (1 << OCIE0A);
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+/** Reads the full 32-bit timebase, accounting for an overflow that is pending but not yet serviced.
+ *
+ *  \return Timebase ticks since the timebase was started, shortly after reset.
+ */
+uint32_t Scheduler_GetTime(void)
+{
+	uint16_t Low;
+	uint16_t High;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Low  = TCNT1;
+		High = Scheduler_TimebaseOverflows;
+
+		if ((TIFR1 & (1 << TOV1)) && (Low < 0x8000))
+		  High++;
+	}
+
+	return ((uint32_t)High << 16) | Low;
+}
+
+/** Returns true if any task has pending work. */
+static bool Scheduler_AnyReady(Scheduler_Task_t* const Tasks,
+                               const uint8_t TotalTasks)
+{
+	uint8_t Now = Scheduler_Ticks;
+
+	for (uint8_t i = 0; i < TotalTasks; i++)
+	{
+		Scheduler_Task_t* Task = &Tasks[i];
+
+		if (Task->PeriodTicks && ((uint8_t)(Now - Task->LastTick) >= Task->PeriodTicks))
+		  return true;
+
+		if (Task->IsReady && Task->IsReady())
+		  return true;
+	}
+
+	return false;
+}
+
+/** Runs the given task table forever. Each pass runs the highest priority ready task, measures
+ *  its run time against its budget, and starts again from the top so that a burst of low priority
+ *  work can never delay a higher priority task by more than one task run. When no task is ready
+ *  the MCU idles until the next interrupt, which at worst is the next scheduler tick.
+ *
+ *  \param[in,out] Tasks       Task table, in priority order.
+ *  \param[in]     TotalTasks  Number of entries in the task table.
+ */
+void Scheduler_Run(Scheduler_Task_t* const Tasks,
+                   const uint8_t TotalTasks)
+{
+	Scheduler_Tasks      = Tasks;
+	Scheduler_TotalTasks = TotalTasks;
+
+	for (;;)
+	{
+		Scheduler_Task_t* Task = NULL;
+		uint8_t           Now  = Scheduler_Ticks;
+
+		for (uint8_t i = 0; i < TotalTasks; i++)
+		{
+			if (Tasks[i].PeriodTicks && ((uint8_t)(Now - Tasks[i].LastTick) >= Tasks[i].PeriodTicks))
+			{
+				Tasks[i].LastTick = Now;
+				Task = &Tasks[i];
+				break;
+			}
+
+			if (Tasks[i].IsReady && Tasks[i].IsReady())
+			{
+				Task = &Tasks[i];
+				break;
+			}
+		}
+
+		if (Task != NULL)
+		{
+			uint16_t Start = Scheduler_GetTimestamp();
+			Task->Run();
+			uint16_t Elapsed = Scheduler_GetTimestamp() - Start;
+
+			Task->Runs++;
+
+			if (Elapsed > Task->WorstTicks)
+			  Task->WorstTicks = Elapsed;
+
+			if (Elapsed > Task->BudgetTicks)
+			  Task->Overruns++;
+
+			continue;
+		}
+
+		/* Re-check with interrupts off so that an interrupt arriving after the scan above cannot be
+		 * missed; SEI only takes effect after the following instruction, so SLEEP is always reached
+		 * with a wake-up source armed.
+		 */
+		cli();
+		if (!(Scheduler_AnyReady(Tasks, TotalTasks)))
+		{
+			Scheduler_Stats.IdleEntries++;
+
+			sleep_enable();
+			sei();
+			sleep_cpu();
+			sleep_disable();
+		}
+		sei();
+	}
+}
@@ -0,0 +1,118 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Header file for Scheduler.c.
+ *
+ *  Fixed-priority cooperative scheduler driven by a Timer0 tick, plus the Timer1
+ *  free-running timebase used to measure task run times and event latencies.
+ */
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+	/* Includes: */
+		#include <stdint.h>
+		#include <stdbool.h>
+		#include <avr/io.h>
+		#include <util/atomic.h>
+
+		#include <LUFA/Common/Common.h>
+
+		#include "Config/AppConfig.h"
+
+	/* Macros: */
+		/** Number of CPU cycles per timebase tick (Timer1 runs from the system clock divided by 8). */
+		#define TIMEBASE_CYCLES_PER_TICK         8
+
+		/** Number of timebase ticks per microsecond. */
+		#define TIMEBASE_TICKS_PER_US            (F_CPU / TIMEBASE_CYCLES_PER_TICK / 1000000UL)
+
+		/** Converts a cycle count into timebase ticks, rounding up. */
+		#define TIMEBASE_CYCLES_TO_TICKS(c)      (((c) + TIMEBASE_CYCLES_PER_TICK - 1) / TIMEBASE_CYCLES_PER_TICK)
+
+	/* Type Defines: */
+		/** Type define for a scheduler task entry. Tasks are listed in priority order, highest first; on
+		 *  every pass the scheduler runs the first task that is ready and then starts again from the top.
+		 */
+		typedef struct
+		{
+			bool     (*IsReady)(void); /**< Returns true when the task has pending work, NULL for purely periodic tasks. */
+			void     (*Run)(void); /**< Task body, must return within its budget. */
+			uint8_t  PeriodTicks; /**< Scheduler ticks between forced runs, zero for purely event driven tasks. */
+			uint16_t BudgetTicks; /**< Run time budget in timebase ticks, see \ref TIMEBASE_CYCLES_TO_TICKS(). */
+
+			uint8_t  LastTick; /**< Scheduler tick of the last periodic run. */
+			uint16_t WorstTicks; /**< Longest run time observed, in timebase ticks. */
+			uint16_t Overruns; /**< Number of runs that exceeded \c BudgetTicks. */
+			uint16_t Runs; /**< Number of runs, wraps. */
+		} Scheduler_Task_t;
+
+		/** Type define for the scheduler wide statistics. */
+		typedef struct
+		{
+			uint16_t IdleEntries; /**< Number of times the MCU was put to sleep, wraps. */
+			uint16_t WorstLatencyTicks; /**< Longest observed MIDI byte arrival to report queued time, in timebase ticks. */
+		} Scheduler_Stats_t;
+
+	/* External Variables: */
+		extern volatile uint8_t  Scheduler_Ticks;
+		extern volatile uint16_t Scheduler_TimebaseOverflows; /**< Upper 16 bits of the 32-bit timebase, incremented on every Timer1 overflow. */
+		extern Scheduler_Stats_t Scheduler_Stats;
+		extern Scheduler_Task_t* Scheduler_Tasks;
+		extern uint8_t           Scheduler_TotalTasks;
+
+	/* Inline Functions: */
+		/** Starts the Timer1 timebase: normal mode, F_CPU/8. This is called as early as possible after
+		 *  reset so that boot times are measured from reset; \ref Scheduler_Init() enables the overflow
+		 *  interrupt that extends it to 32 bits.
+		 */
+		static inline void Scheduler_InitTimebase(void)
+		{
+			TCCR1A = 0;
+			TCCR1B = (1 << CS11);
+		}
+
+		/** Reads the low 16 bits of the free-running timebase. This is cheap enough to call from ISRs to
+		 *  timestamp events; differences between two timestamps are valid for up to 32.7ms.
+		 *
+		 *  \return Current timebase value, in timebase ticks.
+		 */
+		static inline uint16_t Scheduler_GetTimestamp(void)
+		{
+			uint16_t Timestamp;
+
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+			{
+				Timestamp = TCNT1;
+			}
+
+			return Timestamp;
+		}
+
+		/** Records the latency of an event that was timestamped with \ref Scheduler_GetTimestamp(). */
+		static inline void Scheduler_RecordLatency(const uint16_t Timestamp)
+		{
+			uint16_t Latency = Scheduler_GetTimestamp() - Timestamp;
+
+			if (Latency > Scheduler_Stats.WorstLatencyTicks)
+			  Scheduler_Stats.WorstLatencyTicks = Latency;
+		}
+
+	/* Function Prototypes: */
+		void     Scheduler_Init(void);
+		uint32_t Scheduler_GetTime(void);
+		void     Scheduler_Run(Scheduler_Task_t* const Tasks,
+		                       const uint8_t TotalTasks) ATTR_NO_RETURN;
+
+#endif
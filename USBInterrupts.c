@@ -0,0 +1,256 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  USB controller interrupts, device mode only. This follows LUFA's USBInterrupt_AVR8.c, which it
+ *  replaces in the build, with one change: LUFA runs the whole general interrupt with interrupts
+ *  disabled, including the PLL lock wait on VBUS and wake-up, endpoint setup on bus reset and the
+ *  application events. The USART only buffers two received bytes, 640us at 31,250 baud, and input
+ *  capture for MIDI IN2 a single edge, which can be replaced one bit time (32us) later, so here
+ *  only the start of frame event is handled with interrupts disabled; for the rare slow sources,
+ *  the handler masks its own sources and continues with interrupts enabled, the way LUFA already
+ *  runs control requests from the endpoint interrupt.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+
+#include "USBInterrupts.h"
+#include "MIDIInput.h"
+
+#if defined(USB_CAN_BE_HOST) || !defined(USB_SERIES_4_AVR)
+	#error USBInterrupts.c only supports USB device mode on the ATmega16U4 and ATmega32U4.
+#endif
+
+#if (USB_ISR_BLOCKED_BUDGET_CYCLES >= (MIDI_BIT_TICKS * TIMEBASE_CYCLES_PER_TICK))
+	#error USB_ISR_BLOCKED_BUDGET_CYCLES must be shorter than one MIDI bit time, or MIDI IN2 can lose edges.
+#endif
+
+/** General interrupt sources that are handled with interrupts enabled, as their UDIEN enable bits
+ *  (which sit at the same positions as the UDINT flags).
+ */
+#define USB_GEN_SLOW_SOURCES  ((1 << SUSPE) | (1 << WAKEUPE) | (1 << EORSTE))
+
+USBInterrupts_Stats_t USBInterrupts_Stats[USB_INTERRUPT_VECTORS];
+
+/** Records the time an interrupt ran with interrupts disabled. Must be called with interrupts disabled. */
+static inline void USBInterrupts_RecordBlocked(const uint8_t Vector,
+                                               const uint16_t Entry)
+{
+	USBInterrupts_Stats_t* Stats   = &USBInterrupts_Stats[Vector];
+	uint16_t               Blocked = TCNT1 - Entry;
+
+	if (Blocked > Stats->WorstBlockedTicks)
+	  Stats->WorstBlockedTicks = Blocked;
+
+	if (Blocked > USB_ISR_BLOCKED_BUDGET_TICKS)
+	  Stats->Overruns++;
+}
+
+/** Records the total run time of an interrupt. Must be called with interrupts disabled. */
+static inline void USBInterrupts_RecordRun(const uint8_t Vector,
+                                           const uint16_t Entry)
+{
+	USBInterrupts_Stats_t* Stats   = &USBInterrupts_Stats[Vector];
+	uint16_t               Elapsed = TCNT1 - Entry;
+
+	Stats->Runs++;
+
+	if (Elapsed > Stats->WorstRunTicks)
+	  Stats->WorstRunTicks = Elapsed;
+}
+
+void USB_INT_DisableAllInterrupts(void)
+{
+	USBCON &= ~(1 << VBUSTE);
+	UDIEN   = 0;
+}
+
+void USB_INT_ClearAllInterrupts(void)
+{
+	USBINT = 0;
+	UDINT  = 0;
+}
+
+ISR(USB_GEN_vect, ISR_BLOCK)
+{
+	uint16_t Entry = TCNT1;
+
+	#if !defined(NO_SOF_EVENTS)
+	/* The only frequent source, and short: finished before anything else is looked at */
+	if (USB_INT_HasOccurred(USB_INT_SOFI) && USB_INT_IsEnabled(USB_INT_SOFI))
+	{
+		USB_INT_Clear(USB_INT_SOFI);
+
+		EVENT_USB_Device_StartOfFrame();
+	}
+	#endif
+
+	/* Enables of the slow sources as found on entry. They are cleared in the controller for the rest
+	 * of the run so that it cannot re-enter itself; the handlers below update this copy instead, and
+	 * it is written back at the end
+	 */
+	uint8_t Enabled     = UDIEN & USB_GEN_SLOW_SOURCES;
+	bool    VBusEnabled = (USBCON & (1 << VBUSTE));
+
+	if (!(UDINT & Enabled) && !(VBusEnabled && USB_INT_HasOccurred(USB_INT_VBUSTI)))
+	{
+		USBInterrupts_RecordBlocked(USB_VECTOR_GENERAL, Entry);
+		USBInterrupts_RecordRun(USB_VECTOR_GENERAL, Entry);
+		return;
+	}
+
+	uint8_t  PrevSelectedEndpoint = Endpoint_GetCurrentEndpoint();
+	bool     Suspended            = false;
+	uint16_t SuspendEntry;
+
+	UDIEN  &= ~USB_GEN_SLOW_SOURCES;
+	USBCON &= ~(1 << VBUSTE);
+
+	USBInterrupts_RecordBlocked(USB_VECTOR_GENERAL, Entry);
+	GlobalInterruptEnable();
+
+	if (USB_INT_HasOccurred(USB_INT_VBUSTI) && VBusEnabled)
+	{
+		USB_INT_Clear(USB_INT_VBUSTI);
+
+		if (USB_VBUS_GetStatus())
+		{
+			if (!(USB_Options & USB_OPT_MANUAL_PLL))
+			{
+				USB_PLL_On();
+				while (!(USB_PLL_IsReady()));
+			}
+
+			USB_DeviceState = DEVICE_STATE_Powered;
+			EVENT_USB_Device_Connect();
+		}
+		else
+		{
+			if (!(USB_Options & USB_OPT_MANUAL_PLL))
+			  USB_PLL_Off();
+
+			USB_DeviceState = DEVICE_STATE_Unattached;
+			EVENT_USB_Device_Disconnect();
+		}
+	}
+
+	if (USB_INT_HasOccurred(USB_INT_SUSPI) && (Enabled & (1 << SUSPE)))
+	{
+		/* As in LUFA, the wake-up interrupt is enabled in the controller before its clock is frozen,
+		 * not left to the write-back at the end. That unmasks this vector again, so the rest of the
+		 * run is made with interrupts disabled. It is short unless a wake-up follows in the same run,
+		 * and is timed against the budget on its own below
+		 */
+		GlobalInterruptDisable();
+		SuspendEntry = TCNT1;
+		Suspended    = true;
+
+		Enabled &= ~(1 << SUSPE);
+		Enabled |=  (1 << WAKEUPE);
+		UDIEN   |=  (1 << WAKEUPE);
+
+		USB_CLK_Freeze();
+
+		if (!(USB_Options & USB_OPT_MANUAL_PLL))
+		  USB_PLL_Off();
+
+		USB_DeviceState = DEVICE_STATE_Suspended;
+		EVENT_USB_Device_Suspend();
+	}
+
+	if (USB_INT_HasOccurred(USB_INT_WAKEUPI) && (Enabled & (1 << WAKEUPE)))
+	{
+		if (!(USB_Options & USB_OPT_MANUAL_PLL))
+		{
+			USB_PLL_On();
+			while (!(USB_PLL_IsReady()));
+		}
+
+		USB_CLK_Unfreeze();
+
+		USB_INT_Clear(USB_INT_WAKEUPI);
+
+		Enabled &= ~(1 << WAKEUPE);
+		Enabled |=  (1 << SUSPE);
+
+		if (USB_Device_ConfigurationNumber)
+		  USB_DeviceState = DEVICE_STATE_Configured;
+		else
+		  USB_DeviceState = (USB_Device_IsAddressSet()) ? DEVICE_STATE_Addressed : DEVICE_STATE_Powered;
+
+		EVENT_USB_Device_WakeUp();
+	}
+
+	if (USB_INT_HasOccurred(USB_INT_EORSTI) && (Enabled & (1 << EORSTE)))
+	{
+		USB_INT_Clear(USB_INT_EORSTI);
+
+		USB_DeviceState                = DEVICE_STATE_Default;
+		USB_Device_ConfigurationNumber = 0;
+
+		USB_INT_Clear(USB_INT_SUSPI);
+		Enabled &= ~(1 << SUSPE);
+		Enabled |=  (1 << WAKEUPE);
+
+		Endpoint_ConfigureEndpoint(ENDPOINT_CONTROLEP, EP_TYPE_CONTROL,
+		                           USB_Device_ControlEndpointSize, 1);
+
+		#if defined(INTERRUPT_CONTROL_ENDPOINT)
+		USB_INT_Enable(USB_INT_RXSTPI);
+		#endif
+
+		EVENT_USB_Device_Reset();
+	}
+
+	GlobalInterruptDisable();
+
+	if (Suspended)
+	  USBInterrupts_RecordBlocked(USB_VECTOR_GENERAL, SuspendEntry);
+
+	/* Sources that fired while masked are still flagged, and are taken as soon as this returns */
+	UDIEN |= Enabled;
+
+	if (VBusEnabled)
+	  USBCON |= (1 << VBUSTE);
+
+	Endpoint_SelectEndpoint(PrevSelectedEndpoint);
+
+	USBInterrupts_RecordRun(USB_VECTOR_GENERAL, Entry);
+}
+
+#if defined(INTERRUPT_CONTROL_ENDPOINT)
+ISR(USB_COM_vect, ISR_BLOCK)
+{
+	uint16_t Entry                = TCNT1;
+	uint8_t  PrevSelectedEndpoint = Endpoint_GetCurrentEndpoint();
+
+	Endpoint_SelectEndpoint(ENDPOINT_CONTROLEP);
+	USB_INT_Disable(USB_INT_RXSTPI);
+
+	USBInterrupts_RecordBlocked(USB_VECTOR_ENDPOINT, Entry);
+	GlobalInterruptEnable();
+
+	USB_Device_ProcessControlRequest();
+
+	GlobalInterruptDisable();
+
+	Endpoint_SelectEndpoint(ENDPOINT_CONTROLEP);
+	USB_INT_Enable(USB_INT_RXSTPI);
+	Endpoint_SelectEndpoint(PrevSelectedEndpoint);
+
+	USBInterrupts_RecordRun(USB_VECTOR_ENDPOINT, Entry);
+}
+#endif
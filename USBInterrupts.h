@@ -0,0 +1,63 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ *
+ * This project uses the LUFA library, Copyright (C) Dean Camera, 2021.
+ * LUFA is used under its permissive license - see vendor/lufa for details.
+ */
+
+/** \file
+ *
+ *  Header file for USBInterrupts.c.
+ *
+ *  USBInterrupts.c replaces LUFA's USBInterrupt_AVR8.c, so that neither USB interrupt keeps
+ *  interrupts disabled for longer than a few dozen cycles and the MIDI receive interrupts can
+ *  always preempt them. The time each vector runs with interrupts disabled is measured and read
+ *  out through the diagnostics channel as \ref DIAG_BLOCK_USB_INTERRUPTS.
+ */
+
+#ifndef _USB_INTERRUPTS_H_
+#define _USB_INTERRUPTS_H_
+
+	/* Includes: */
+		#include <stdint.h>
+
+		#include "Config/AppConfig.h"
+		#include "Scheduler.h"
+
+	/* Macros: */
+		/** Number of USB interrupt vectors with statistics. */
+		#define USB_INTERRUPT_VECTORS            2
+
+		/** Blocked time budget of the USB interrupts, in timebase ticks. */
+		#define USB_ISR_BLOCKED_BUDGET_TICKS     TIMEBASE_CYCLES_TO_TICKS(USB_ISR_BLOCKED_BUDGET_CYCLES)
+
+	/* Enums: */
+		/** Enum for the USB interrupt vectors, indexing \ref USBInterrupts_Stats. */
+		enum USBInterrupts_Vector_t
+		{
+			USB_VECTOR_GENERAL  = 0, /**< USB_GEN_vect: start of frame, VBUS, suspend, wake-up and bus reset. */
+			USB_VECTOR_ENDPOINT = 1, /**< USB_COM_vect: SETUP packets on the control endpoint. */
+		};
+
+	/* Type Defines: */
+		/** Type define for the per-vector statistics. Blocked time is measured from the timestamp taken on
+		 *  entry, after the register saves of the interrupt prologue (about 30 cycles with ISR_BLOCK), to
+		 *  the point where interrupts are enabled again or the handler returns.
+		 */
+		typedef struct
+		{
+			uint16_t WorstBlockedTicks; /**< Longest time with interrupts disabled, in timebase ticks. */
+			uint16_t WorstRunTicks; /**< Longest total run time, including interrupts that nested into it. */
+			uint16_t Overruns; /**< Number of runs that kept interrupts disabled for longer than \ref USB_ISR_BLOCKED_BUDGET_TICKS. */
+			uint16_t Runs; /**< Number of runs, wraps. */
+		} USBInterrupts_Stats_t;
+
+	/* External Variables: */
+		extern USBInterrupts_Stats_t USBInterrupts_Stats[USB_INTERRUPT_VECTORS];
+
+#endif
@@ -16,21 +16,23 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include "rockband.h"
-
-#define MIDI_BAUD 31250UL
+#include "DrumCore.h"
+#include "Scheduler.h"
+#include "Diagnostics.h"
+#include "MIDIStream.h"
+#include "MIDIInput.h"
+#include "FlightRecorder.h"
+
+// Control requests must be serviced from USB_COM_vect as soon as a SETUP arrives: polled from
+// the housekeeping task, every control transfer stage would wait for the next scheduler tick
+#if !defined(INTERRUPT_CONTROL_ENDPOINT)
+    #error INTERRUPT_CONTROL_ENDPOINT must be defined in Config/LUFAConfig.h.
+#endif
 
 #define LED_PIN PC7
 
 #define BUFFER_SIZE 8  // Size of the circular buffer
 
-typedef struct {
-    uint8_t button[2];
-    uint8_t hat;
-    uint8_t X, Y, Z, Rz;
-    uint8_t vendor8[12];
-    uint16_t vendor16[4];
-} HIDReport_t;
-
 typedef struct {
     HIDReport_t buffer[BUFFER_SIZE];
     uint8_t head;
@@ -63,6 +65,14 @@ bool cb_is_empty(CircularBuffer_t *cb) {
     return (!cb->full && (cb->head == cb->tail));
 }
 
+// Number of reports waiting
+uint8_t cb_count(CircularBuffer_t *cb) {
+    if (cb->full) {
+        return BUFFER_SIZE;
+    }
+    return (cb->head + BUFFER_SIZE - cb->tail) % BUFFER_SIZE;
+}
+
 // Add an element to the buffer (copy report)
 void cb_push(CircularBuffer_t *cb, const HIDReport_t *item) {
     memcpy(&cb->buffer[cb->head], item, sizeof(HIDReport_t));
@@ -79,63 +89,6 @@ bool cb_pop(CircularBuffer_t *cb, HIDReport_t *item) {
     return true;
 }
 
-/*
-00 00 08 7F 7F 7F 7F 00 00 00 00 00 00 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Nothing
-20 00 08 7F 7F 7F 7F 00 00 00 00 00 00 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Kick 2 Black
-10 00 08 7F 7F 7F 7F 00 00 00 00 00 00 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Kick 1 Orange
-04 04 08 7F 7F 7F 7F 00 00 00 00 00 FF 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Red / 1
-08 04 08 7F 7F 7F 7F 00 00 00 00 FF 00 00 00 00 00 00 00 02 00 02 00 02 00 02 00 Yellow / 2
-01 04 08 7F 7F 7F 7F 00 00 00 00 00 00 00 FF 00 00 00 00 02 00 02 00 02 00 02 00 Blue / 3
-02 04 08 7F 7F 7F 7F 00 00 00 00 00 00 FF 00 00 00 00 00 02 00 02 00 02 00 02 00 Green / 4
-      XX Hat = 08 centered, clockwise 00 up, 01 up/right, 02 right, etc
-   XX buttons = 08 cymbal, 04 drum hit, 01 minus, 02 plus, 10 home 
-XX buttons = 01 1, 08 2, 02 A, 04 B
-10 04 08 7F 7F 7F 7F 00 00 00 00 00 00 00 00 66 00 00 00 02 00 02 00 02 00 02 00
-08 04 08 7F 7F 7F 7F 00 00 00 00 00 00 00 6B
-02 08 08 7F 7F 7F 7F 00 00 00 00 00 00 FF 00 00 00 00 00 02 00 02 00 02 00 02 00
-*/
-
-#define PEDAL  0xA0
-#define KICK   0xA1
-#define CYMBAL 0xB0
-/*
-Hex: 0x2c | Decimal: 44 | MIDI Note: G#2
-Hex: 0x24 | Decimal: 36 | MIDI Note: C2
-Hex: 0x31 | Decimal: 49 | MIDI Note: C#3
-Hex: 0x2e | Decimal: 46 | MIDI Note: A#2
-Hex: 0x33 | Decimal: 51 | MIDI Note: D#3
-Hex: 0x2d | Decimal: 45 | MIDI Note: A2
-Hex: 0x2b | Decimal: 43 | MIDI Note: G2
-Hex: 0x26 | Decimal: 38 | MIDI Note: D2
-Hex: 0x30 | Decimal: 48 | MIDI Note: C3
-*/
-uint8_t map_note(uint8_t x) {
-    switch (x) {
-        case 0x2C: return PEDAL; 	// Pedal         
-        case 0x24: return KICK; 	// Kick
-		case 0x31: return CYMBAL | 0;	// Blue Cymbal 
-        case 0x2E: return CYMBAL | 3;	// Yellow Cymbal
-		case 0x33: return CYMBAL | 1;	// Green Cymbal
-        case 0x2D: return 0;		// Blue
-        case 0x2B: return 1;		// Green
-	    case 0x26: return 2;		// Red
-        case 0x30: return 3;		// Yellow
-        default: return 0xFF;
-    }
-}
-
-HIDReport_t default_report = {
-    .button = {0x00, 0x00},
-    .hat    = 0x08,
-    .X      = 0x7F,
-    .Y      = 0x7F,
-    .Z      = 0x7F,
-    .Rz     = 0x7F,
-    .vendor8 = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-                0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-    .vendor16 = {0x0002, 0x0002, 0x0002, 0x0002}
-};
-
 static uint8_t HIDReportBuffer[sizeof(HIDReport_t)];
 
 USB_ClassInfo_HID_Device_t HID_Interface =
@@ -154,170 +107,237 @@ USB_ClassInfo_HID_Device_t HID_Interface =
 			},
 	};
 
-void uart_send(uint8_t data) {
-    // Wait for empty transmit buffer
-    while (!(UCSR1A & (1 << UDRE1)));
-    // Put data into buffer
-    UDR1 = data;
+typedef struct {
+    uint8_t data[MIDI_SIZE];
+    uint16_t stamp;          // Timebase timestamp of the last byte
+} MidiMessage_t;
+
+// Parser state per input port, only touched by the UART task
+static MidiParser_t midi_parsers[MIDI_INPUT_PORTS];
+
+// Parsed messages waiting for the planning task
+static MidiMessage_t midi_queue[MIDI_QUEUE_SIZE];
+static uint8_t midi_queue_head = 0;
+static uint8_t midi_queue_tail = 0;
+
+static CircularBuffer_t cb;
+
+static HIDReport_t report = {
+    .button = {0x00, 0x00},
+    .hat    = 0x08,
+    .X      = 0x7F,
+    .Y      = 0x7F,
+    .Z      = 0x7F,
+    .Rz     = 0x7F,
+    .vendor8 = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .vendor16 = {0x0002, 0x0002, 0x0002, 0x0002}
+};
+
+/** UART task: drains the MIDI input rings, oldest byte first across ports, through each port's
+ *  MIDI parser into the message queue. */
+static bool UART_Task_IsReady(void) {
+    uint8_t next = (midi_queue_head + 1) & (MIDI_QUEUE_SIZE - 1);
+    return MIDIInput_IsPending() && (next != midi_queue_tail || USB_DeviceState != DEVICE_STATE_Configured);
 }
 
-void uart_init(void) {
-    // Calculate UBRR value for the desired baud rate
-    uint16_t ubrr = (F_CPU / (16UL * MIDI_BAUD)) - 1;
+static void UART_Task(void) {
+    for (uint8_t i = 0; i < UART_TASK_MAX_BYTES; i++) {
+        uint8_t next = (midi_queue_head + 1) & (MIDI_QUEUE_SIZE - 1);
+        MIDIInput_Byte_t in;
+
+        // Stop when the message queue is full so that the remaining bytes stay in the
+        // rings until the planning task catches up, or when the rings are empty. Before the
+        // host has configured the device nothing drains the queue, and bytes left waiting
+        // would overrun the rings and corrupt the stream mid-message, so parsing carries on
+        if ((next == midi_queue_tail && USB_DeviceState == DEVICE_STATE_Configured) || !MIDIInput_Pop(&in))
+            break;
+
+        MidiParser_t *parser = &midi_parsers[in.Port];
+
+        if (midi_parse_byte(parser, in.Data)) {
+            // Queue full before configuration: the oldest message makes way for the newest
+            if (next == midi_queue_tail)
+                midi_queue_tail = (midi_queue_tail + 1) & (MIDI_QUEUE_SIZE - 1);
+
+            MidiMessage_t *msg = &midi_queue[midi_queue_head];
+            msg->data[0] = parser->buffer[0];
+            msg->data[1] = parser->buffer[1];
+            msg->data[2] = parser->buffer[2];
+            msg->stamp = in.Stamp;
+            midi_queue_head = next;
+
+            FlightRecorder_Record(FR_EVT_MIDI | in.Port, msg->data[0], msg->data[1], msg->data[2]);
+            FlightRecorder_CheckMessage(msg->data);
+
+#if defined(ENABLE_USB_MIDI)
+            MIDIStream_QueueMessage(msg->data);
+#endif
+        }
+    }
+}
+
+/** Planning task: applies one parsed MIDI message to the report state and queues the resulting report. */
+static bool Plan_Task_IsReady(void) {
+    // The latest messages received before the host has configured the device stay queued until
+    // it has, rather than being turned into reports nobody collects
+    if (USB_DeviceState != DEVICE_STATE_Configured)
+        return false;
+
+    return midi_queue_head != midi_queue_tail;
+}
+
+static void Plan_Task(void) {
+    MidiMessage_t *msg = &midi_queue[midi_queue_tail];
+
+    uint8_t result = report_apply_message(&report, msg->data);
 
-    // Set baud rate
-    UBRR1H = (uint8_t)(ubrr >> 8);
-    UBRR1L = (uint8_t)ubrr;
+    if (result & REPORT_PAD_ON)
+        PORTC |= (1 << LED_PIN);
+    else if (result & REPORT_PAD_OFF)
+        PORTC &= ~(1 << LED_PIN);
 
-    // Enable transmitter and receiver
-    UCSR1B = (1 << TXEN1) | (1 << RXEN1) | (1<<RXCIE1);
+#if defined(DIAG_REPORT_TIMESTAMPS)
+    // Extend the 16-bit arrival stamp to the full timebase, it is always less than 32ms old
+    uint32_t now = Scheduler_GetTime();
+    uint32_t arrival = now - (uint16_t)((uint16_t)now - msg->stamp);
+    report.vendor16[0] = (uint16_t)arrival;
+    report.vendor16[1] = (uint16_t)(arrival >> 16);
+#endif
 
-    // Set frame format: 8 data bits, no parity, 1 stop bit
-    UCSR1C = (1 << UCSZ11) | (1 << UCSZ10);
+    if (result & REPORT_CHANGED) {
+        uint8_t event = cb.full ? FR_EVT_REPORT_DROPPED : FR_EVT_REPORT_QUEUED;
+        cb_push(&cb, &report);
+        FlightRecorder_Record(event, cb_count(&cb), report.button[0], report.button[1]);
+    }
+
+    // Messages held during enumeration would only skew the worst case
+    if (BootTrace.FirstReport != 0)
+        Scheduler_RecordLatency(msg->stamp);
+    midi_queue_tail = (midi_queue_tail + 1) & (MIDI_QUEUE_SIZE - 1);
 }
 
-#define MIDI_SIZE 3  // Max message size we expect
-#define NOTE_OFF       0x80
-#define NOTE_ON        0x90
-#define CONTROL_CHANGE 0xB0
-
-volatile uint8_t midi_buffer[MIDI_SIZE];
-volatile uint8_t midi_index = 0;
-volatile uint8_t midi_byte = 0;       // Last status byte
-volatile uint8_t midi_complete = 0;   // Flag: 1 when message complete
-
-// Helper: get expected MIDI message length from status byte
-static uint8_t midi_message_length(uint8_t status) {
-    if ((status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0)
-        return 2;  // Program Change & Channel Pressure
-    else
-        return 3;  // Note on/off, Control Change, etc.
+/** Endpoint task: discards host OUT data and keeps the HID IN endpoint bank loaded. */
+static bool Endpoint_Task_IsReady(void) {
+    if (USB_DeviceState != DEVICE_STATE_Configured)
+        return false;
+
+    Endpoint_SelectEndpoint(HID_OUT_EPADDR);
+    if (Endpoint_IsOUTReceived())
+        return true;
+
+    Endpoint_SelectEndpoint(HID_IN_EPADDR);
+    return Endpoint_IsINReady();
 }
 
-ISR(USART1_RX_vect) {
-    uint8_t byte = UDR1;
-
-    if (byte & 0x80) {
-        // Status byte detected: start new message
-        midi_index = 0;
-        midi_buffer[midi_index++] = byte;
-        midi_byte = byte;
-        midi_complete = 0; // reset flag
-    } else {
-        // Data byte
-        if (midi_index < MIDI_SIZE) {
-            midi_buffer[midi_index++] = byte;
+static void Endpoint_Task(void) {
+    // Service OUT endpoint first (if host sent data). The data is unused, so the bank is
+    // released without reading it rather than waiting on a full-size stream read.
+    Endpoint_SelectEndpoint(HID_OUT_EPADDR);
+    if (Endpoint_IsOUTReceived()) {
+        Endpoint_ClearOUT();
+    }
+
+    // Service IN endpoint (host requested data)
+    Endpoint_SelectEndpoint(HID_IN_EPADDR);
+    if (Endpoint_IsINReady()) {
+        HIDReport_t r;
+        if (cb_pop(&cb, &r)) {
+#if defined(DIAG_REPORT_TIMESTAMPS)
+            r.vendor16[2] = Scheduler_GetTimestamp();
+            r.vendor16[3] = USB_Device_GetFrameNumber();
+#endif
+            Endpoint_Write_Stream_LE((uint8_t *)&r, sizeof(r), NULL);
+            FlightRecorder_Record(FR_EVT_REPORT_SENT, cb_count(&cb), r.button[0], r.button[1]);
+            if (BootTrace.FirstReport == 0)
+                BootTrace.FirstReport = Scheduler_GetTime();
+        } else {
+            Endpoint_Write_Stream_LE((uint8_t *)&default_report, sizeof(default_report), NULL);
         }
+        Endpoint_ClearIN(); // this signals the host that data is ready
     }
+}
+
+#if defined(ENABLE_FLIGHT_RECORDER)
+// Input error counters as last recorded
+static MIDIInput_Stats_t rx_stats_seen[MIDI_INPUT_PORTS];
+#endif
+
+/** Housekeeping task: periodic USB stack management. Control requests do not wait for this task;
+ *  they are handled from USB_COM_vect (INTERRUPT_CONTROL_ENDPOINT), so USB_USBTask() finds no
+ *  pending SETUP here in practice. */
+static void Housekeeping_Task(void) {
+    USB_USBTask();
+
+#if defined(ENABLE_FLIGHT_RECORDER)
+    // Input errors are counted in the receive ISRs, so they are recorded from here, up to one tick late
+    for (uint8_t port = 0; port < MIDI_INPUT_PORTS; port++) {
+        MIDIInput_Stats_t stats;
 
-    // Check if message is complete
-    if (midi_index >= midi_message_length(midi_byte)) {
-        midi_complete = 1;  // flag message ready for main loop
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            stats = MIDIInput_Stats[port];
+        }
+
+        if (stats.Overruns != rx_stats_seen[port].Overruns ||
+            stats.FramingErrors != rx_stats_seen[port].FramingErrors) {
+            rx_stats_seen[port] = stats;
+            FlightRecorder_Record(FR_EVT_RX_LOST | port, stats.Overruns & 0xFF, stats.Overruns >> 8,
+                                  stats.FramingErrors & 0xFF);
+        }
     }
+#endif
 }
 
-/** Main program entry point. This routine configures the hardware required by the application, then
- *  enters a loop to run the application tasks in sequence.
+/** Scheduler task table, highest priority first. */
+static Scheduler_Task_t Tasks[] = {
+    { .IsReady = UART_Task_IsReady,     .Run = UART_Task,         .BudgetTicks = TIMEBASE_CYCLES_TO_TICKS(TASK_BUDGET_UART_CYCLES) },
+    { .IsReady = Plan_Task_IsReady,     .Run = Plan_Task,         .BudgetTicks = TIMEBASE_CYCLES_TO_TICKS(TASK_BUDGET_PLAN_CYCLES) },
+    { .IsReady = Endpoint_Task_IsReady, .Run = Endpoint_Task,     .BudgetTicks = TIMEBASE_CYCLES_TO_TICKS(TASK_BUDGET_ENDPOINT_CYCLES) },
+#if defined(ENABLE_USB_MIDI)
+    { .IsReady = MIDIStream_Task_IsReady, .Run = MIDIStream_Task, .PeriodTicks = 1,
+                                                                  .BudgetTicks = TIMEBASE_CYCLES_TO_TICKS(TASK_BUDGET_MIDI_STREAM_CYCLES) },
+#endif
+    { .PeriodTicks = 1,                 .Run = Housekeeping_Task, .BudgetTicks = TIMEBASE_CYCLES_TO_TICKS(TASK_BUDGET_HOUSEKEEPING_CYCLES) },
+};
+
+/** MCUSR as found at reset, saved by EarlyInit() before .bss is cleared. */
+static uint8_t reset_cause __attribute__((section(".noinit")));
+
+/** Runs from .init3, before the C runtime copies .data and clears .bss. A watchdog reset leaves the
+ *  watchdog enabled with its shortest timeout, so it has to be stopped before anything else; the
+ *  clock prescaler is cleared here too so the runtime initialisation already runs at full speed,
+ *  and the timebase is started so that the boot trace measures from reset.
  */
-int main(void)
+void EarlyInit(void) __attribute__((naked, used, section(".init3")));
+void EarlyInit(void)
 {
-    CircularBuffer_t cb;
-    cb_init(&cb);
-    DDRC |= (1 << LED_PIN);
-	uart_init();
-	MCUSR &= ~(1 << WDRF);
+	reset_cause = MCUSR;
+	MCUSR = 0;
 	wdt_disable();
 	/* Disable clock division */
 	clock_prescale_set(clock_div_1);
+	Scheduler_InitTimebase();
+}
+
+/** Main program entry point. This routine configures the hardware required by the application, then
+ *  hands control to the scheduler to run the application tasks.
+ */
+int main(void)
+{
+	BootTrace.ResetCause = reset_cause;
+
+	/* Start receiving MIDI before attaching so nothing played during enumeration is lost */
+	MIDIInput_Init();
 	/* Hardware Initialization */
 	USB_Init();
+	BootTrace.Attach = Scheduler_GetTime();
 
-	GlobalInterruptEnable();
-
-	HIDReport_t report = {
-		.button = {0x00, 0x00},
-		.hat    = 0x08,
-		.X      = 0x7F,
-		.Y      = 0x7F,
-		.Z      = 0x7F,
-		.Rz     = 0x7F,
-		.vendor8 = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-					0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-		.vendor16 = {0x0002, 0x0002, 0x0002, 0x0002}
-	};
+	DDRC |= (1 << LED_PIN);
+	Scheduler_Init();
 
-	for (;;)
-	{
-		USB_USBTask();
-
-		if (midi_complete != 0) {
-			uint8_t type = midi_buffer[0] & 0xF0;   // upper nibble = message type
-    		uint8_t channel = midi_buffer[0] & 0x0F;
-            uint8_t note = midi_buffer[1];
-            uint8_t velocity = midi_buffer[2];
-			report.vendor8[9] = midi_buffer[0];
-			report.vendor8[10] = midi_buffer[1];
-			report.vendor8[11] = midi_buffer[2];
-			
-			if (type == NOTE_OFF || (type == NOTE_ON && velocity == 0)) {
-				uint8_t offset = map_note(note);
-				if (offset == 0xFF) {
-					cb_push(&cb, &report);
-				} else if (offset == PEDAL) {
-					report.button[1] &= ~0x02;
-					cb_push(&cb, &report);
-				} else if (offset == KICK) {
-					report.button[0] &= ~0x10;
-					cb_push(&cb, &report);
-				} else if (offset >= 0) {
-					PORTC &= ~(1 << LED_PIN);
-					report.button[0] &= ~(1 << (offset & ~CYMBAL));
-					report.vendor8[5+(offset & ~CYMBAL)] = 0;
-					cb_push(&cb, &report);
-				}
-			} else if (type == NOTE_ON) {
-				uint8_t offset = map_note(note);
-				if (offset == 0xFF) {
-					cb_push(&cb, &report);
-				} else if (offset == PEDAL) {
-					report.button[1] |= 0x02;
-					cb_push(&cb, &report);
-				} else if (offset == KICK) {
-					report.button[0] |= 0x10;
-					cb_push(&cb, &report);
-				} else if (offset >= 0) {
-					PORTC |= (1 << LED_PIN);
-					report.button[0] |= (1 << (offset & ~CYMBAL));
-					report.button[1] = (offset & CYMBAL) ? 0x08 : 0x04;
-					report.vendor8[5+(offset & ~CYMBAL)] = velocity;
-					cb_push(&cb, &report);
-				}
-			}
-            midi_complete = 0;  // Clear flag
-        } 
-
-		// Service OUT endpoint first (if host sent data)
-		Endpoint_SelectEndpoint(HID_OUT_EPADDR);
-		if (Endpoint_IsOUTReceived()) {
-			uint8_t received[HID_IO_EPSIZE];
-			Endpoint_Read_Stream_LE(received, HID_IO_EPSIZE, NULL);
-			Endpoint_ClearOUT();
-		}
-
-		// Service IN endpoint (host requested data)
-		Endpoint_SelectEndpoint(HID_IN_EPADDR);
-		if (Endpoint_IsINReady()) {
-			HIDReport_t r;
-			if (cb_pop(&cb, &r)) {
-				Endpoint_Write_Stream_LE((uint8_t *)&r, sizeof(r), NULL);
-			} else {
-				Endpoint_Write_Stream_LE((uint8_t *)&default_report, sizeof(default_report), NULL);
-			}
-			Endpoint_ClearIN(); // this signals the host that data is ready
-		}
+	GlobalInterruptEnable();
 
-		
-	}
+	Scheduler_Run(Tasks, sizeof(Tasks) / sizeof(Tasks[0]));
 }
 
 /** Event handler for the USB_Connect event. This indicates that the device is enumerating via the status LEDs. */
@@ -343,6 +363,10 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 {
 	bool ConfigSuccess = true;
 
+	BootTrace.Configured = Scheduler_GetTime();
+	BootTrace.FirstReport = 0;
+	BootTrace.Configurations++;
+
 	/* Setup Vendor Data Endpoints */
 	//ConfigSuccess &= Endpoint_ConfigureEndpoint(VENDOR1_IN_EPADDR,  EP_TYPE_INTERRUPT, VENDOR_IO_EPSIZE, 1);
 	//ConfigSuccess &= Endpoint_ConfigureEndpoint(VENDOR1_OUT_EPADDR, EP_TYPE_INTERRUPT, VENDOR_IO_EPSIZE, 1);
@@ -351,11 +375,25 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 	//ConfigSuccess &= Endpoint_ConfigureEndpoint(VENDOR2_OUT_EPADDR, EP_TYPE_INTERRUPT, VENDOR_IO_EPSIZE, 1);
 	ConfigSuccess &= Endpoint_ConfigureEndpoint(HID_IN_EPADDR,  EP_TYPE_INTERRUPT, HID_IO_EPSIZE, 1);
 	ConfigSuccess &= Endpoint_ConfigureEndpoint(HID_OUT_EPADDR, EP_TYPE_INTERRUPT, HID_IO_EPSIZE, 1);
+#if defined(ENABLE_USB_MIDI)
+	ConfigSuccess &= MIDIStream_ConfigureEndpoints();
+#endif
+#if defined(ENABLE_CLOCK_SYNC)
+	USB_Device_EnableSOFEvents();
+#endif
 	/* Indicate endpoint configuration success or failure */
 	/* Indicate endpoint configuration success or failure */
 	//LEDs_SetAllLEDs(ConfigSuccess ? LEDMASK_USB_READY : LEDMASK_USB_ERROR);
 }
 
+#if defined(ENABLE_CLOCK_SYNC)
+/** Event handler for the USB_StartOfFrame event. This timestamps each start of frame for host clock synchronisation. */
+void EVENT_USB_Device_StartOfFrame(void)
+{
+	Diagnostics_StartOfFrame();
+}
+#endif
+
 /** Event handler for the USB_ControlRequest event. This is used to catch and process control requests sent to
  *  the device from the USB host before passing along unhandled control requests to the library for processing
  *  internally.
@@ -366,7 +404,21 @@ void EVENT_USB_Device_ControlRequest(void)
 	switch (USB_ControlRequest.bRequest)
 	{
 		case HID_REQ_GetReport:
-			if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
+			if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE) &&
+			    ((USB_ControlRequest.wValue >> 8) - 1) == HID_REPORT_ITEM_Feature)
+			{
+				uint8_t DiagReport[DIAG_REPORT_SIZE];
+
+				/* Create the next diagnostics chunk for transmission to the host */
+				Diagnostics_CreateReport(DiagReport);
+
+				Endpoint_ClearSETUP();
+
+				/* Write the report data to the control endpoint */
+				Endpoint_Write_Control_Stream_LE(DiagReport, sizeof(DiagReport));
+				Endpoint_ClearOUT();
+			}
+			else if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
 			{
 				//USB_KeyboardReport_Data_t KeyboardReportData;
 
@@ -382,7 +434,20 @@ void EVENT_USB_Device_ControlRequest(void)
 
 			break;
 		case HID_REQ_SetReport:
-			if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE))
+			if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE) &&
+			    ((USB_ControlRequest.wValue >> 8) - 1) == HID_REPORT_ITEM_Feature)
+			{
+				uint8_t DiagReport[DIAG_REPORT_SIZE];
+
+				Endpoint_ClearSETUP();
+
+				/* Read in the diagnostics command from the host */
+				Endpoint_Read_Control_Stream_LE(DiagReport, sizeof(DiagReport));
+				Endpoint_ClearIN();
+
+				Diagnostics_ProcessCommand(DiagReport);
+			}
+			else if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE))
 			{
 				Endpoint_ClearSETUP();
 
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+Boot Trace Reader for Rock Band MIDI-to-USB Drum Controller
+
+Reads the firmware's boot trace and scheduler statistics through the vendor
+feature report, and prints the reset -> attach -> configured -> first report
+timeline. Plug the adapter in, hit a pad once, then run this tool.
+
+Usage:
+    python3 boot_trace.py [--tasks] [--ports] [--check]
+
+Requirements:
+    pip install hidapi
+
+Output:
+    - Time from reset to USB attach, configuration and first report
+    - Worst-case MIDI byte to report latency
+    - Per-task run time, budget and overrun counts (with --tasks)
+    - Per-port MIDI error counts and worst receive ISR time, THRU statistics,
+      USB-MIDI packet drops and USB interrupt blocked times (with --ports)
+    - Exit status 1 if any byte was lost or received late, or a USB interrupt
+      went over its blocked time budget (with --check, for scripted soak tests)
+"""
+
+import argparse
+import sys
+
+from rb_diag import (DiagDevice, DIAG_BLOCK_BOOT_TRACE, DIAG_BLOCK_SCHEDULER_STATS,
+                     DIAG_BLOCK_SCHEDULER_TASKS, DIAG_BLOCK_MIDI_INPUT,
+                     DIAG_BLOCK_MIDI_THRU, DIAG_BLOCK_USB_INTERRUPTS, DIAG_BLOCK_MIDI_STREAM,
+                     TICKS_PER_US, ticks_to_ms, unpack)
+
+# BootTrace_t: ResetCause, Configurations, Attach, Configured, FirstReport
+BOOT_TRACE_FMT = "BBIII"
+BOOT_TRACE_SIZE = 14
+
+# Scheduler_Stats_t: IdleEntries, WorstLatencyTicks
+SCHEDULER_STATS_FMT = "HH"
+SCHEDULER_STATS_SIZE = 4
+
+# Scheduler_Task_t: IsReady, Run, PeriodTicks, BudgetTicks, LastTick, WorstTicks, Overruns, Runs
+TASK_FMT = "HHBHBHHH"
+TASK_SIZE = 14
+MAX_TASKS = 8
+
+# Task table layouts, by number of tasks in the build
+TASK_NAMES = {
+    4: ["uart", "plan", "endpoint", "housekeeping"],
+    5: ["uart", "plan", "endpoint", "midi-stream", "housekeeping"],
+}
+
+# MIDIInput_Stats_t: Overruns, FramingErrors, WorstIsrTicks, LateReads
+PORT_FMT = "HHHH"
+PORT_SIZE = 8
+PORT_NAMES = ["usart (PD2)", "capture (PD4)"]
+
+# MIDIThru_Stats_t: Forwarded, Filtered, Dropped, WorstDelayTicks
+THRU_FMT = "HHHH"
+THRU_SIZE = 8
+
+# MIDIStream_Dropped
+STREAM_FMT = "H"
+STREAM_SIZE = 2
+
+# USBInterrupts_Stats_t: WorstBlockedTicks, WorstRunTicks, Overruns, Runs
+USB_ISR_FMT = "HHHH"
+USB_ISR_SIZE = 8
+USB_ISR_NAMES = ["USB_GEN_vect", "USB_COM_vect"]
+
+RESET_CAUSES = {0x01: "power-on", 0x02: "external", 0x04: "brown-out", 0x08: "watchdog", 0x10: "JTAG"}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Read the boot trace from Rock Band drum controller",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__
+    )
+    parser.add_argument("--tasks", action="store_true", help="Also print per-task scheduler statistics")
+    parser.add_argument("--ports", action="store_true",
+                        help="Also print MIDI input, THRU and USB interrupt statistics")
+    parser.add_argument("--check", action="store_true",
+                        help="Exit with status 1 if input was lost or late, or a USB interrupt overran")
+    args = parser.parse_args()
+
+    dev = DiagDevice()
+
+    cause, configs, attach, configured, first = unpack(
+        BOOT_TRACE_FMT, dev.read_block(DIAG_BLOCK_BOOT_TRACE, BOOT_TRACE_SIZE))
+    causes = ", ".join(name for bit, name in RESET_CAUSES.items() if cause & bit) or "unknown"
+
+    print(f"Reset cause:     0x{cause:02X} ({causes})")
+    print(f"Configurations:  {configs}")
+    print(f"reset -> attach:       {ticks_to_ms(attach):9.3f} ms")
+    print(f"reset -> configured:   {ticks_to_ms(configured):9.3f} ms")
+    if first:
+        print(f"reset -> first report: {ticks_to_ms(first):9.3f} ms "
+              f"(configured + {ticks_to_ms(first - configured):.3f} ms)")
+    else:
+        print("reset -> first report:  (no hit since configuration)")
+
+    idle, worst = unpack(SCHEDULER_STATS_FMT,
+                         dev.read_block(DIAG_BLOCK_SCHEDULER_STATS, SCHEDULER_STATS_SIZE))
+    print(f"Worst byte -> report latency: {worst / TICKS_PER_US:.1f} us")
+
+    if args.tasks:
+        data = dev.read_block(DIAG_BLOCK_SCHEDULER_TASKS, TASK_SIZE * MAX_TASKS)
+        tasks = [unpack(TASK_FMT, data[i * TASK_SIZE:]) for i in range(MAX_TASKS)]
+        tasks = [t for t in tasks if t[1] != 0]  # Past the end of the table reads as zero
+        names = TASK_NAMES.get(len(tasks), [f"task {i}" for i in range(len(tasks))])
+
+        print()
+        print(f"{'task':<14}{'budget us':>10}{'worst us':>10}{'overruns':>10}{'runs':>8}")
+        for name, (_, _, _, budget, _, worst, overruns, runs) in zip(names, tasks):
+            print(f"{name:<14}{budget / TICKS_PER_US:>10.1f}{worst / TICKS_PER_US:>10.1f}"
+                  f"{overruns:>10}{runs:>8}")
+
+    # The capture port reads as zero when the firmware is built without ENABLE_MIDI_IN2
+    data = dev.read_block(DIAG_BLOCK_MIDI_INPUT, PORT_SIZE * len(PORT_NAMES))
+    ports = [unpack(PORT_FMT, data[i * PORT_SIZE:]) for i in range(len(PORT_NAMES))]
+    data = dev.read_block(DIAG_BLOCK_USB_INTERRUPTS, USB_ISR_SIZE * len(USB_ISR_NAMES))
+    usb_isrs = [unpack(USB_ISR_FMT, data[i * USB_ISR_SIZE:]) for i in range(len(USB_ISR_NAMES))]
+
+    if args.ports:
+        print()
+        print(f"{'port':<16}{'overruns':>10}{'framing':>10}{'late':>10}{'isr us':>10}")
+        for name, (overruns, framing, isr, late) in zip(PORT_NAMES, ports):
+            print(f"{name:<16}{overruns:>10}{framing:>10}{late:>10}{isr / TICKS_PER_US:>10.1f}")
+
+        # Reads as zero when the firmware is built without ENABLE_MIDI_THRU
+        forwarded, filtered, dropped, delay = unpack(
+            THRU_FMT, dev.read_block(DIAG_BLOCK_MIDI_THRU, THRU_SIZE))
+        print()
+        print(f"THRU: {forwarded} forwarded, {filtered} filtered, {dropped} dropped, "
+              f"worst receive -> transmit {delay / TICKS_PER_US:.1f} us")
+
+        # Reads as zero when the firmware is built without ENABLE_USB_MIDI
+        stream_dropped, = unpack(STREAM_FMT, dev.read_block(DIAG_BLOCK_MIDI_STREAM, STREAM_SIZE))
+        print(f"USB-MIDI: {stream_dropped} packets dropped")
+
+        print()
+        print(f"{'interrupt':<16}{'blocked us':>11}{'run us':>10}{'overruns':>10}{'runs':>8}")
+        for name, (blocked, run, overruns, runs) in zip(USB_ISR_NAMES, usb_isrs):
+            print(f"{name:<16}{blocked / TICKS_PER_US:>11.1f}{run / TICKS_PER_US:>10.1f}"
+                  f"{overruns:>10}{runs:>8}")
+
+    dev.close()
+
+    if args.check:
+        failures = []
+        for name, (overruns, framing, isr, late) in zip(PORT_NAMES, ports):
+            if overruns or late:
+                failures.append(f"{name}: {overruns} overruns, {late} late reads")
+        for name, (blocked, run, overruns, runs) in zip(USB_ISR_NAMES, usb_isrs):
+            if overruns:
+                failures.append(f"{name}: {overruns} runs over budget, worst {blocked / TICKS_PER_US:.1f} us")
+
+        print()
+        print("\n".join(f"FAIL {f}" for f in failures) if failures else "PASS")
+        sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
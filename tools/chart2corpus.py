@@ -0,0 +1,428 @@
+#!/usr/bin/env python3
+"""
+Chart to Kit MIDI Load Corpus Generator for Rock Band MIDI-to-USB Drum Controller
+
+Reads Rock Band chart MIDI files (notes.mid, PART DRUMS track) and writes the
+MIDI byte stream a real kit would send while playing the chart, as a kit
+corpus file (see kit_corpus.py). Notes are chosen by inverting map_note() in
+DrumCore.c, so every gem arrives as the note the firmware maps to that pad
+or cymbal. Timing and velocity are humanised, and clock, active sensing,
+hi-hat pedal CC4 and pad crosstalk can be mixed in.
+
+Usage:
+    python3 chart2corpus.py notes.mid -o song.rbkc
+    python3 chart2corpus.py songs/ -o corpus/ --clock --active-sensing --hihat-cc4 40
+
+Requirements:
+    None (standard library only)
+
+Pro drums: Yellow, blue and green gems are cymbals unless a tom marker
+(notes 110, 111, 112) covers them, as in Rock Band 3. Use --no-pro for
+charts without tom markers, to play those lanes as toms.
+"""
+
+import argparse
+import bisect
+import os
+import random
+import struct
+import sys
+import zlib
+
+from kit_corpus import (write_corpus, BYTE_US, CORPUS_FLAG_RUNNING_STATUS, CORPUS_FLAG_CLOCK,
+                        CORPUS_FLAG_ACTIVE_SENSING, CORPUS_FLAG_HIHAT_CC4, CORPUS_FLAG_CROSSTALK)
+
+# Chart lanes, offsets from the difficulty's base note
+LANE_KICK, LANE_RED, LANE_YELLOW, LANE_BLUE, LANE_GREEN = range(5)
+DIFFICULTY_BASE = {"easy": 60, "medium": 72, "hard": 84, "expert": 96}
+EXPERT_PLUS_KICK = 95
+TOM_MARKERS = {110: LANE_YELLOW, 111: LANE_BLUE, 112: LANE_GREEN}
+
+# Inverse of map_note() in DrumCore.c: (lane, cymbal) -> kit note
+KIT_NOTE = {
+    (LANE_KICK, False): 0x24,
+    (LANE_RED, False): 0x26,
+    (LANE_YELLOW, False): 0x30,
+    (LANE_YELLOW, True): 0x2E,
+    (LANE_BLUE, False): 0x2D,
+    (LANE_BLUE, True): 0x31,
+    (LANE_GREEN, False): 0x2B,
+    (LANE_GREEN, True): 0x33,
+}
+HIHAT_PEDAL_NOTE = 0x2C
+
+# Typical playing velocity per kit note, before humanisation
+BASE_VELOCITY = {0x24: 100, 0x26: 96, 0x30: 88, 0x2D: 88, 0x2B: 92, 0x2E: 80, 0x31: 95, 0x33: 85}
+
+# Active sensing interval: receivers time out after 300 ms of silence, so kits send it a little sooner
+ACTIVE_SENSING_US = 270000
+
+# Order of realtime bytes due at the same time: Start before the first clock, Stop after the last
+REALTIME_PRIORITY = {0xFA: 0, 0xF8: 1, 0xFC: 2}
+
+
+class ChartError(Exception):
+    pass
+
+
+def read_varlen(data, pos):
+    value = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value = (value << 7) | (byte & 0x7F)
+        if not byte & 0x80:
+            return value, pos
+
+
+def read_smf(path):
+    """Parse a standard MIDI file into (division, tracks); each track is a list of
+    (tick, kind, payload) with kind 'note_on', 'note_off', 'tempo' or 'name'."""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data[:4] != b"MThd":
+        raise ChartError("not a standard MIDI file")
+    length, _, ntracks, division = struct.unpack(">IHHH", data[4:14])
+    if division & 0x8000:
+        raise ChartError("SMPTE time division is not supported")
+
+    pos = 8 + length
+    tracks = []
+    for _ in range(ntracks):
+        if data[pos:pos + 4] != b"MTrk":
+            raise ChartError("missing track chunk")
+        (length,) = struct.unpack(">I", data[pos + 4:pos + 8])
+        pos += 8
+        end = pos + length
+        tick = 0
+        status = 0
+        events = []
+
+        while pos < end:
+            delta, pos = read_varlen(data, pos)
+            tick += delta
+            byte = data[pos]
+
+            if byte == 0xFF:
+                kind = data[pos + 1]
+                size, pos = read_varlen(data, pos + 2)
+                payload = data[pos:pos + size]
+                pos += size
+                if kind == 0x51:
+                    events.append((tick, "tempo", int.from_bytes(payload, "big")))
+                elif kind == 0x03:
+                    events.append((tick, "name", payload.decode("latin-1")))
+                continue
+
+            if byte in (0xF0, 0xF7):
+                size, pos = read_varlen(data, pos + 1)
+                pos += size
+                continue
+
+            if byte & 0x80:
+                status = byte
+                pos += 1
+            elif not status:
+                raise ChartError("data byte without status")
+
+            kind = status & 0xF0
+            size = 1 if kind in (0xC0, 0xD0) else 2
+            args = data[pos:pos + size]
+            pos += size
+
+            if kind == 0x90 and args[1]:
+                events.append((tick, "note_on", args[0]))
+            elif kind in (0x80, 0x90):
+                events.append((tick, "note_off", args[0]))
+
+        tracks.append(events)
+        pos = end
+
+    return division, tracks
+
+
+class TempoMap:
+    """Converts ticks to microseconds."""
+
+    def __init__(self, division, tempo_events):
+        self.division = division
+        self.ticks = [0]
+        self.us = [0.0]
+        self.tempo = [500000]
+        for tick, tempo in sorted(tempo_events):
+            us = self.to_us(tick)
+            if tick == self.ticks[-1]:
+                self.tempo[-1] = tempo
+            else:
+                self.ticks.append(tick)
+                self.us.append(us)
+                self.tempo.append(tempo)
+
+    def to_us(self, tick):
+        i = bisect.bisect_right(self.ticks, tick) - 1
+        return self.us[i] + (tick - self.ticks[i]) * self.tempo[i] / self.division
+
+    def clock_times(self, end_tick):
+        """Times of the 24 ppq MIDI clock up to end_tick."""
+        step = self.division / 24.0
+        tick = 0.0
+        while tick <= end_tick:
+            yield self.to_us(tick)
+            tick += step
+
+
+def load_chart(path, difficulty, pro, double_kick):
+    """Return (gems, tempo map, end tick); gems are (tick, lane, cymbal) in tick order."""
+    division, tracks = read_smf(path)
+
+    tempo_events = [(t, v) for track in tracks for t, kind, v in track if kind == "tempo"]
+    tempo = TempoMap(division, tempo_events)
+
+    drums = None
+    for track in tracks:
+        if any(kind == "name" and value.strip() == "PART DRUMS" for _, kind, value in track):
+            drums = track
+            break
+    if drums is None:
+        raise ChartError("no PART DRUMS track")
+
+    base = DIFFICULTY_BASE[difficulty]
+
+    # Tom marker ranges per lane, as (start, end) tick pairs
+    markers = {lane: [] for lane in TOM_MARKERS.values()}
+    open_markers = {}
+    for tick, kind, note in drums:
+        if note in TOM_MARKERS:
+            if kind == "note_on":
+                open_markers[note] = tick
+            elif note in open_markers:
+                markers[TOM_MARKERS[note]].append((open_markers.pop(note), tick))
+
+    def is_tom(lane, tick):
+        return any(start <= tick < end for start, end in markers.get(lane, ()))
+
+    gems = []
+    for tick, kind, note in drums:
+        if kind != "note_on":
+            continue
+        if base <= note <= base + LANE_GREEN:
+            lane = note - base
+        elif double_kick and difficulty == "expert" and note == EXPERT_PLUS_KICK:
+            lane = LANE_KICK
+        else:
+            continue
+
+        cymbal = lane in (LANE_YELLOW, LANE_BLUE, LANE_GREEN) and pro and not is_tom(lane, tick)
+        gems.append((tick, lane, cymbal))
+
+    end_tick = max((t for track in tracks for t, _, _ in track), default=0)
+    return gems, tempo, end_tick
+
+
+def humanise(gems, tempo, args, rng):
+    """Turn chart gems into timed kit messages: list of (time_us, [bytes])."""
+    status_on = 0x90 | (args.channel - 1)
+    messages = []
+
+    for tick, lane, cymbal in gems:
+        note = KIT_NOTE[(lane, cymbal)]
+        time = max(0.0, tempo.to_us(tick) + rng.gauss(0.0, args.jitter_ms * 1000.0))
+        velocity = int(round(rng.gauss(BASE_VELOCITY[note], args.velocity_jitter)))
+        velocity = min(127, max(1, velocity))
+
+        messages.append((time, [status_on, note, velocity]))
+        if args.gate_ms > 0:
+            messages.append((time + args.gate_ms * 1000.0, [status_on, note, 0]))
+
+        if args.crosstalk and lane != LANE_KICK and rng.random() < args.crosstalk:
+            ghost = rng.choice([n for n in BASE_VELOCITY if n not in (note, 0x24)])
+            ghost_time = time + rng.uniform(500.0, 3000.0)
+            messages.append((ghost_time, [status_on, ghost, rng.randint(1, 12)]))
+            if args.gate_ms > 0:
+                messages.append((ghost_time + args.gate_ms * 1000.0, [status_on, ghost, 0]))
+
+    return messages
+
+
+def hihat_stream(duration_us, args, rng):
+    """Hi-hat pedal position as a CC4 random walk, with a pedal chick note on every close."""
+    status_cc = 0xB0 | (args.channel - 1)
+    status_on = 0x90 | (args.channel - 1)
+    messages = []
+    period = 1e6 / args.hihat_cc4
+    position = 0
+    time = 0.0
+
+    while time < duration_us:
+        target = 127 if rng.random() < 0.3 else rng.randint(0, 90)
+        while position != target and time < duration_us:
+            position = min(position + 8, target) if target > position else max(position - 8, target)
+            messages.append((time, [status_cc, 0x04, position]))
+            if position == 127:
+                messages.append((time, [status_on, HIHAT_PEDAL_NOTE, rng.randint(40, 90)]))
+                messages.append((time + 20000.0, [status_on, HIHAT_PEDAL_NOTE, 0]))
+            time += period
+        time += rng.uniform(50000.0, 400000.0)
+
+    return messages
+
+
+def serialise(messages, realtime, running_status):
+    """Lay messages and realtime bytes out on a 31,250 baud line. Realtime bytes go out at their
+    time even in the middle of a message, as a kit's MIDI output would do. Returns (time, byte)."""
+    messages = sorted(messages, key=lambda m: m[0])
+    realtime = sorted(realtime, key=lambda r: (r[0], REALTIME_PRIORITY.get(r[1], 1)))
+    out = []
+    line = 0
+    last_status = None
+    pending = []
+    mi = ri = 0
+    never = float("inf")
+
+    while True:
+        if pending:
+            next_message = line
+        elif mi < len(messages):
+            next_message = max(line, int(messages[mi][0]))
+        else:
+            next_message = never
+        next_realtime = max(line, int(realtime[ri][0])) if ri < len(realtime) else never
+
+        if next_message == never and next_realtime == never:
+            break
+
+        if next_realtime <= next_message:
+            time, byte = next_realtime, realtime[ri][1]
+            ri += 1
+        else:
+            if not pending:
+                pending = list(messages[mi][1])
+                mi += 1
+                if running_status and pending[0] == last_status:
+                    pending.pop(0)
+                else:
+                    last_status = pending[0]
+            time, byte = next_message, pending.pop(0)
+
+        out.append((time, byte))
+        line = time + BYTE_US
+
+    return out
+
+
+def add_active_sensing(stream):
+    """Fill every silence longer than 270 ms with active sensing, as kits that send it do.
+
+    Times are byte start times, so an FE only goes in where it finishes on the
+    line before the next byte starts. Sensing starts with the first byte.
+    """
+    out = []
+    previous = None
+    for time, byte in stream:
+        while previous is not None and time - previous >= ACTIVE_SENSING_US + BYTE_US:
+            previous += ACTIVE_SENSING_US
+            out.append((previous, 0xFE))
+        out.append((time, byte))
+        previous = time
+    return out
+
+
+def convert(path, output, args):
+    seed = args.seed if args.seed is not None else zlib.crc32(os.path.abspath(path).encode("utf-8"))
+    rng = random.Random(seed)
+
+    gems, tempo, end_tick = load_chart(path, args.difficulty, not args.no_pro, args.double_kick)
+    messages = humanise(gems, tempo, args, rng)
+    duration = tempo.to_us(end_tick)
+    flags = 0 if args.no_running_status else CORPUS_FLAG_RUNNING_STATUS
+
+    if args.hihat_cc4:
+        messages += hihat_stream(duration, args, rng)
+        flags |= CORPUS_FLAG_HIHAT_CC4
+    if args.crosstalk:
+        flags |= CORPUS_FLAG_CROSSTALK
+
+    realtime = []
+    if args.clock:
+        realtime = [(0, 0xFA)] + [(t, 0xF8) for t in tempo.clock_times(end_tick)] + [(duration, 0xFC)]
+        flags |= CORPUS_FLAG_CLOCK
+
+    stream = serialise(messages, realtime, not args.no_running_status)
+    if args.active_sensing:
+        stream = add_active_sensing(stream)
+        flags |= CORPUS_FLAG_ACTIVE_SENSING
+
+    name = os.path.basename(os.path.dirname(os.path.abspath(path))) if args.name is None else args.name
+    write_corpus(output, stream, name=name, seed=seed, flags=flags)
+
+    # Busiest second on the wire, as a share of the line rate
+    times = [t for t, _ in stream]
+    busiest = 0
+    j = 0
+    for i, t in enumerate(times):
+        while times[j] < t - 1000000:
+            j += 1
+        busiest = max(busiest, i - j + 1)
+
+    print(f"{output}: {len(gems)} gems, {len(stream)} bytes, {duration / 1e6:.1f} s, "
+          f"busiest second {busiest} bytes ({100.0 * busiest * BYTE_US / 1e6:.0f}% of line rate)")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Convert Rock Band drum charts into kit MIDI load corpora",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__
+    )
+    parser.add_argument("input", help="Chart MIDI file, or a directory searched for *.mid files")
+    parser.add_argument("-o", "--output", required=True,
+                        help="Output file, or directory when the input is a directory")
+    parser.add_argument("--difficulty", choices=DIFFICULTY_BASE, default="expert")
+    parser.add_argument("--double-kick", action="store_true", help="Include Expert+ kicks (note 95)")
+    parser.add_argument("--no-pro", action="store_true", help="Ignore tom markers, play Y/B/G as toms")
+    parser.add_argument("--channel", type=int, default=10, help="Kit MIDI channel (default: 10)")
+    parser.add_argument("--jitter-ms", type=float, default=2.0, help="Timing jitter, std dev (default: 2)")
+    parser.add_argument("--velocity-jitter", type=float, default=10.0, help="Velocity std dev (default: 10)")
+    parser.add_argument("--gate-ms", type=float, default=30.0,
+                        help="Note on velocity 0 after this long, 0 for none (default: 30)")
+    parser.add_argument("--no-running-status", action="store_true", help="Send every status byte")
+    parser.add_argument("--clock", action="store_true", help="Add 24 ppq MIDI clock with start/stop")
+    parser.add_argument("--active-sensing", action="store_true", help="Add active sensing in silences")
+    parser.add_argument("--hihat-cc4", type=float, default=0.0, metavar="HZ",
+                        help="Add a hi-hat pedal CC4 stream at this update rate")
+    parser.add_argument("--crosstalk", type=float, default=0.0, metavar="P",
+                        help="Probability of a ghost note on another pad per hit")
+    parser.add_argument("--seed", type=int, help="Random seed (default: derived from the input path)")
+    parser.add_argument("--name", help="Song name stored in the corpus (default: the chart's folder name)")
+    args = parser.parse_args()
+
+    if not 1 <= args.channel <= 16:
+        parser.error("--channel must be 1-16")
+
+    if os.path.isdir(args.input):
+        os.makedirs(args.output, exist_ok=True)
+        failed = 0
+        for root, _, files in sorted(os.walk(args.input)):
+            for name in sorted(files):
+                if not name.lower().endswith(".mid"):
+                    continue
+                path = os.path.join(root, name)
+                song = os.path.relpath(root, args.input).replace(os.sep, "_")
+                stem = os.path.splitext(name)[0] if song == "." else song
+                try:
+                    convert(path, os.path.join(args.output, stem + ".rbkc"), args)
+                except (ChartError, IndexError, struct.error) as e:
+                    print(f"{path}: skipped, {e or 'truncated file'}", file=sys.stderr)
+                    failed += 1
+        sys.exit(1 if failed else 0)
+
+    try:
+        convert(args.input, args.output, args)
+    except ChartError as e:
+        print(f"{args.input}: {e}", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
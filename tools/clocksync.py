@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+"""
+Device-Host Clock Synchronisation for Rock Band MIDI-to-USB Drum Controller
+
+Maps firmware timebase timestamps (Timer1, 0.5 us ticks, 32 bits) onto the
+host's CLOCK_MONOTONIC, so device-side events such as a MIDI byte arriving
+can be compared with host-side events such as a HID read returning.
+
+Each sample is one GET_REPORT (Feature) of the DIAG_BLOCK_CLOCK block: the
+host reads CLOCK_MONOTONIC before and after the request, and the device
+reports its timebase at the moment it handled it. Samples with the shortest
+round trips bound the offset most tightly, so the offset is the median over
+the fastest quarter of a sliding window, and the error bound is half the
+fastest round trip. Over hidraw a GET_REPORT control transfer takes one to a
+few USB frames, so the bound is typically several hundred microseconds, not
+tens: the device cannot tell where in the round trip it answered. The start
+of frame stamps do not tighten it, as the host never learns the
+CLOCK_MONOTONIC time of a frame; they only refine the drift. Latency splits
+built on this mapping (hit_latency.py) carry the same offset error.
+
+The rate used for the mapping, and the drift printed against
+CLOCK_MONOTONIC, is fitted to the fast round trip samples once they span a
+second. When the firmware is built with ENABLE_CLOCK_SYNC it also timestamps
+every USB start of frame. The host controller sends those every 1 ms on its
+own frame clock, so the timebase ticks counted between two frames far apart
+give the drift against that clock with almost no USB scheduling noise. That
+is not CLOCK_MONOTONIC: the two can differ by tens of ppm, so the frame
+drift is reported separately and only stands in for the mapping rate until
+the round trips span enough time.
+
+Usage as a library:
+    sync = ClockSync(DiagDevice())
+    sync.update(64)
+    host_ns = sync.to_host_ns(device_ticks)
+
+Usage as a tool:
+    python3 clocksync.py [--seconds 10]
+
+Requirements:
+    pip install hidapi
+"""
+
+import argparse
+import statistics
+import struct
+import time
+
+from rb_diag import DiagDevice, DIAG_BLOCK_CLOCK, DIAG_CMD_SELECT, TICKS_PER_US
+
+# ClockSample_t: Time, SofFrame, SofTime
+CLOCK_SAMPLE_FMT = "<IHI"
+
+# Nominal timebase rate in ticks per nanosecond
+NOMINAL_RATE = TICKS_PER_US / 1000.0
+
+TICKS_WRAP = 1 << 32
+FRAMES_WRAP = 1 << 11
+TICKS_PER_FRAME = TICKS_PER_US * 1000
+
+
+def monotonic_ns():
+    return time.clock_gettime_ns(time.CLOCK_MONOTONIC)
+
+
+class ClockSync:
+    """Running estimate of the device timebase to CLOCK_MONOTONIC mapping."""
+
+    def __init__(self, dev, window=256):
+        self.dev = dev
+        self.window = window
+        self.samples = []      # (rtt_ns, host_mid_ns, device_ticks unwrapped, sof_frame, sof_ticks)
+        self.rate = NOMINAL_RATE
+        self.ref_host = None
+        self.ref_ticks = None
+        self.error_ns = None
+        self.rate_source = "nominal"
+        self.sof_rate = None
+        self.dev.command(DIAG_CMD_SELECT, DIAG_BLOCK_CLOCK, 0, 0)
+
+    def _unwrap(self, ticks, near):
+        """Place 32-bit device ticks in the wrap period closest to `near`."""
+        if near is None:
+            return ticks
+        base = near - (near % TICKS_WRAP)
+        candidates = (base - TICKS_WRAP + ticks, base + ticks, base + TICKS_WRAP + ticks)
+        return min(candidates, key=lambda c: abs(c - near))
+
+    def sample(self):
+        """Take one round trip sample and add it to the window."""
+        before = monotonic_ns()
+        first = self.dev.chunk()
+        after = monotonic_ns()
+        second = self.dev.chunk()
+
+        if first[0] != DIAG_BLOCK_CLOCK or (first[1] | first[2] << 8) != 0:
+            # Someone else moved the read offset; start over
+            self.dev.command(DIAG_CMD_SELECT, DIAG_BLOCK_CLOCK, 0, 0)
+            return None
+
+        ticks, sof_frame, sof_ticks = struct.unpack(CLOCK_SAMPLE_FMT, first[3:8] + second[3:8])
+        last = self.samples[-1][2] if self.samples else None
+        ticks = self._unwrap(ticks, last)
+        sof_ticks = self._unwrap(sof_ticks, ticks) if sof_ticks else 0
+
+        entry = (after - before, (before + after) // 2, ticks, sof_frame, sof_ticks)
+        self.samples.append(entry)
+        del self.samples[:-self.window]
+        return entry
+
+    def _sof_rate(self):
+        """Timebase rate against the host controller's frame clock, None if unavailable."""
+        sof = [(s[4], s[3]) for s in self.samples if s[4]]
+        if len(sof) < 2:
+            return None
+        (t0, f0), (t1, f1) = sof[0], sof[-1]
+        if t1 - t0 < 100 * TICKS_PER_FRAME:
+            return None
+        # Whole frames between the two, using the nominal rate to resolve the 11-bit wrap
+        frames = (f1 - f0) % FRAMES_WRAP
+        frames += FRAMES_WRAP * round(((t1 - t0) / TICKS_PER_FRAME - frames) / FRAMES_WRAP)
+        return (t1 - t0) / (frames * 1e6)
+
+    def estimate(self):
+        """Recompute rate and offset from the current window."""
+        if not self.samples:
+            raise RuntimeError("no clock samples")
+
+        ordered = sorted(self.samples)
+        fast = ordered[:max(1, len(ordered) // 4)]
+
+        # Rate against CLOCK_MONOTONIC from the round trips; the frame clock rate only stands in
+        # for it while the round trips are too close together to fit
+        self.sof_rate = self._sof_rate()
+        rate = None
+        if len(fast) >= 4:
+            hosts = [s[1] for s in fast]
+            ticks = [s[2] for s in fast]
+            mean_h = statistics.fmean(hosts)
+            mean_t = statistics.fmean(ticks)
+            var = sum((h - mean_h) ** 2 for h in hosts)
+            if var > 0 and max(hosts) - min(hosts) > 1e9:
+                rate = sum((h - mean_h) * (t - mean_t) for h, t in zip(hosts, ticks)) / var
+        if rate is not None:
+            self.rate, self.rate_source = rate, "rtt"
+        elif self.sof_rate is not None:
+            self.rate, self.rate_source = self.sof_rate, "sof"
+
+        # Reference point: latest sample's ticks, host time from the median fast-sample offset
+        self.ref_ticks = self.samples[-1][2]
+        self.ref_host = statistics.median(s[1] + (self.ref_ticks - s[2]) / self.rate for s in fast)
+        self.error_ns = ordered[0][0] / 2
+
+    def update(self, count=16, interval=0.0):
+        """Take `count` samples, then re-estimate."""
+        for _ in range(count):
+            self.sample()
+            if interval:
+                time.sleep(interval)
+        self.estimate()
+
+    def to_host_ns(self, device_ticks):
+        """Map a 32-bit device timebase timestamp to CLOCK_MONOTONIC nanoseconds."""
+        ticks = self._unwrap(device_ticks, self.ref_ticks)
+        return self.ref_host + (ticks - self.ref_ticks) / self.rate
+
+    @property
+    def drift_ppm(self):
+        """Drift of the rate used for the mapping to CLOCK_MONOTONIC."""
+        return (self.rate / NOMINAL_RATE - 1.0) * 1e6
+
+    @property
+    def sof_drift_ppm(self):
+        """Drift against the host controller's frame clock, None without start of frame stamps."""
+        return None if self.sof_rate is None else (self.sof_rate / NOMINAL_RATE - 1.0) * 1e6
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Track the device clock against CLOCK_MONOTONIC",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__
+    )
+    parser.add_argument("--seconds", type=float, default=10.0, help="How long to run (default: 10)")
+    args = parser.parse_args()
+
+    dev = DiagDevice()
+    sync = ClockSync(dev)
+    end = time.monotonic() + args.seconds
+
+    # drift: against CLOCK_MONOTONIC, as used for the mapping (source: rtt fit, or sof while the
+    # round trips span less than a second); frame drift: against the host controller's frame clock
+    print(f"{'elapsed s':>9} {'drift ppm':>10} {'source':>8} {'frame drift ppm':>16} "
+          f"{'min rtt us':>11} {'error us':>9} {'residual us':>12}")
+    start = time.monotonic()
+    while time.monotonic() < end:
+        sync.update(32, interval=0.005)
+        # How far the newest sample lands from the fitted mapping
+        rtt, host_mid, ticks, _, _ = sync.samples[-1]
+        residual = (host_mid - sync.to_host_ns(ticks & 0xFFFFFFFF)) / 1000.0
+        sof = sync.sof_drift_ppm
+        print(f"{time.monotonic() - start:9.1f} {sync.drift_ppm:10.2f} {sync.rate_source:>8} "
+              f"{'-' if sof is None else f'{sof:.2f}':>16} {min(s[0] for s in sync.samples) / 1000.0:11.1f} "
+              f"{sync.error_ns / 1000.0:9.1f} {residual:12.1f}")
+
+    dev.close()
+
+    print(f"Offset is only known to within +/-{sync.error_ns / 1000.0:.0f} us (half the fastest round "
+          f"trip); start of frame stamps refine the drift, not the offset")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+Kit MIDI Load Corpus Player for Rock Band MIDI-to-USB Drum Controller
+
+Replays a kit corpus (see kit_corpus.py) into a MIDI output at its recorded
+timing, or dumps it.
+
+Usage:
+    python3 corpus_play.py song.rbkc --info
+    python3 corpus_play.py song.rbkc --dump | less
+    python3 corpus_play.py song.rbkc --device /dev/snd/midiC1D0
+    python3 corpus_play.py song.rbkc --raw | ./rbmidid/rbmidid -r
+
+Requirements:
+    None (standard library only)
+
+Notes:
+    The stream is already laid out at 31,250 baud, so replaying it at its
+    timestamps drives the line at the rate the kit would. --speed 0 writes
+    as fast as the device accepts, for throughput and loss tests.
+"""
+
+import argparse
+import os
+import sys
+import time
+
+from kit_corpus import (Corpus, BYTE_US, CORPUS_FLAG_RUNNING_STATUS, CORPUS_FLAG_CLOCK,
+                        CORPUS_FLAG_ACTIVE_SENSING, CORPUS_FLAG_HIHAT_CC4, CORPUS_FLAG_CROSSTALK)
+
+FLAG_NAMES = {
+    CORPUS_FLAG_RUNNING_STATUS: "running status",
+    CORPUS_FLAG_CLOCK: "clock",
+    CORPUS_FLAG_ACTIVE_SENSING: "active sensing",
+    CORPUS_FLAG_HIHAT_CC4: "hi-hat CC4",
+    CORPUS_FLAG_CROSSTALK: "crosstalk",
+}
+
+
+def play(corpus, fd, start_us, speed):
+    """Write the stream to fd from start_us, at its timestamps divided by speed."""
+    first = corpus.seek(start_us)
+    t0 = time.monotonic()
+    written = 0
+    late = 0.0
+
+    for n in range(first, corpus.segments):
+        begin, end, stamp = corpus.segment(n)
+        batch = bytearray()
+        batch_due = None
+
+        for i in range(begin, end):
+            stamp += corpus.deltas[i]
+            if stamp < start_us:
+                continue
+
+            if speed > 0:
+                due = t0 + (stamp - start_us) / 1e6 / speed
+                # Bytes that fall due within one byte time of the first go out in one write
+                if batch and due - batch_due > BYTE_US / 1e6:
+                    written += os.write(fd, batch)
+                    batch.clear()
+                if not batch:
+                    wait = due - time.monotonic()
+                    if wait > 0:
+                        time.sleep(wait)
+                    else:
+                        late = max(late, -wait)
+                    batch_due = due
+
+            batch.append(corpus.data[i])
+
+        if batch:
+            written += os.write(fd, batch)
+
+    return written, late
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Replay a kit MIDI load corpus",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__
+    )
+    parser.add_argument("corpus", help="Corpus file")
+    mode = parser.add_mutually_exclusive_group(required=True)
+    mode.add_argument("--info", action="store_true", help="Print the header and index summary")
+    mode.add_argument("--dump", action="store_true", help="Print every byte with its time")
+    mode.add_argument("--raw", action="store_true", help="Write the bytes to stdout, without timing")
+    mode.add_argument("--device", help="MIDI output to replay into (ALSA rawmidi or serial device)")
+    parser.add_argument("--start", type=float, default=0.0, help="Start time in seconds")
+    parser.add_argument("--speed", type=float, default=1.0,
+                        help="Playback speed factor, 0 for as fast as possible (default: 1)")
+    args = parser.parse_args()
+
+    corpus = Corpus(args.corpus)
+
+    if args.info:
+        flags = ", ".join(name for bit, name in FLAG_NAMES.items() if corpus.flags & bit) or "none"
+        print(f"Song:      {corpus.name}")
+        print(f"Bytes:     {corpus.count}")
+        print(f"Duration:  {corpus.duration / 1e6:.3f} s")
+        print(f"Segments:  {corpus.segments}")
+        print(f"Seed:      {corpus.seed}")
+        print(f"Content:   {flags}")
+        if corpus.duration:
+            load = 100.0 * corpus.count * BYTE_US / corpus.duration
+            print(f"Mean load: {load:.1f}% of line rate")
+    elif args.dump:
+        start = args.start * 1e6
+        for stamp, byte in corpus:
+            if stamp >= start:
+                print(f"{stamp / 1000.0:12.3f} ms  {byte:02X}")
+    elif args.raw:
+        sys.stdout.buffer.write(bytes(b for stamp, b in corpus if stamp >= args.start * 1e6))
+    else:
+        fd = os.open(args.device, os.O_WRONLY)
+        try:
+            written, late = play(corpus, fd, int(args.start * 1e6), args.speed)
+        except KeyboardInterrupt:
+            written, late = 0, 0.0
+        os.close(fd)
+        print(f"{written} bytes written, worst lateness {late * 1000.0:.3f} ms", file=sys.stderr)
+
+    corpus.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+Flight Recorder Reader for Rock Band MIDI-to-USB Drum Controller
+
+Freezes the firmware's flight recorder, reads it out through the vendor
+feature report and prints the recorded MIDI, report queue and report
+endpoint events as a timeline ending at the freeze.
+
+Usage:
+    python3 flight_recorder.py              # Freeze now and dump
+    python3 flight_recorder.py --no-freeze  # Dump an already frozen recorder
+    python3 flight_recorder.py --arm [--trigger NOTE]
+
+Requirements:
+    pip install hidapi
+
+The recorder can also be frozen from the kit side, without a host attached:
+a note on for the trigger note (see --arm), or the SysEx F0 7D 46 F7.
+The firmware only returns the records once the recorder is frozen.
+"""
+
+import argparse
+import sys
+
+from rb_diag import (DiagDevice, DIAG_BLOCK_FLIGHT_RECORDER, DIAG_CMD_RECORDER_ARM,
+                     DIAG_CMD_RECORDER_FREEZE, unpack, ticks_to_ms)
+
+# FlightRecorder_t header: Head, Frozen, FreezeCause, TriggerNote, FreezeTime, Untimed
+HEADER_FMT = "BBBBIB"
+HEADER_SIZE = 9
+
+# FlightRecord_t: Time (low 16 bits of the timebase), Event, Data[3]
+RECORD_FMT = "HBBBB"
+RECORD_SIZE = 6
+
+# Must match FLIGHT_RECORDER_RECORDS in Config/AppConfig.h
+DEFAULT_RECORDS = 128
+
+CAUSES = {0: "still recording", 1: "host command", 2: "trigger note", 3: "trigger SysEx"}
+
+# FlightRecorder_Event_t, upper nibble of Event
+FR_EVT_MIDI = 0x10
+FR_EVT_RX_LOST = 0x20
+FR_EVT_REPORT_QUEUED = 0x30
+FR_EVT_REPORT_DROPPED = 0x40
+FR_EVT_REPORT_SENT = 0x50
+FR_EVT_TIME = 0x60
+
+
+def describe_midi(status, data1, data2):
+    """Short description of a channel message."""
+    kind = status & 0xF0
+    channel = (status & 0x0F) + 1
+    if kind == 0x90 and data2:
+        return f"note on  {data1:3} vel {data2:3} ch {channel}"
+    if kind == 0x80 or kind == 0x90:
+        return f"note off {data1:3} ch {channel}"
+    if kind == 0xA0:
+        return f"aftertouch {data1:3} val {data2:3} ch {channel}"
+    if kind == 0xB0:
+        return f"CC {data1:3} val {data2:3} ch {channel}"
+    return ""
+
+
+def describe(event, data):
+    """Decode one record into (source, text)."""
+    kind = event & 0xF0
+    port = event & 0x0F
+
+    if kind == FR_EVT_MIDI:
+        raw = " ".join(f"{b:02X}" for b in data)
+        return f"midi in{port + 1}", f"{raw}  {describe_midi(*data)}"
+    if kind == FR_EVT_RX_LOST:
+        return f"midi in{port + 1}", f"input errors: {data[0] | (data[1] << 8)} overruns, {data[2]} framing (totals)"
+    if kind in (FR_EVT_REPORT_QUEUED, FR_EVT_REPORT_DROPPED, FR_EVT_REPORT_SENT):
+        what = {FR_EVT_REPORT_QUEUED: "queued", FR_EVT_REPORT_DROPPED: "queued, DROPPED oldest",
+                FR_EVT_REPORT_SENT: "sent"}[kind]
+        return "report", f"buttons {data[1]:02X} {data[2]:02X}  {what}, depth {data[0]}"
+    return "?", f"event 0x{event:02X} data {data.hex()}"
+
+
+def full_times(records, freeze_time):
+    """Rebuild 32-bit times for records in ring order, oldest first.
+
+    Each record holds the low half of the timebase; the upper half is in the
+    next FR_EVT_TIME record. Returns (time, event, data) for the other records.
+    """
+    upper = None
+    timed = []
+    for time, event, d0, d1, d2 in reversed(records):
+        if event == FR_EVT_TIME:
+            upper = d0 | (d1 << 8)
+            continue
+        if upper is None:
+            # Written after the last time record; only the freeze can follow them
+            upper = freeze_time >> 16
+            if time > (freeze_time & 0xFFFF):
+                upper -= 1
+        timed.append(((upper << 16) | time, event, bytes((d0, d1, d2))))
+    timed.reverse()
+    return timed
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Read the flight recorder from Rock Band drum controller",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__
+    )
+    parser.add_argument("--no-freeze", action="store_true", help="Do not freeze before reading")
+    parser.add_argument("--arm", action="store_true", help="Resume recording instead of reading")
+    parser.add_argument("--trigger", type=int, default=0xFF,
+                        help="Trigger note number for --arm (default: none)")
+    parser.add_argument("--records", type=int, default=DEFAULT_RECORDS,
+                        help=f"Number of records in the firmware build (default: {DEFAULT_RECORDS})")
+    args = parser.parse_args()
+
+    dev = DiagDevice()
+
+    if args.arm:
+        dev.command(DIAG_CMD_RECORDER_ARM, args.trigger & 0xFF)
+        trigger = "none" if args.trigger == 0xFF else str(args.trigger)
+        print(f"Flight recorder armed, trigger note: {trigger}")
+        dev.close()
+        return
+
+    if not args.no_freeze:
+        dev.command(DIAG_CMD_RECORDER_FREEZE)
+
+    header = dev.read_block(DIAG_BLOCK_FLIGHT_RECORDER, HEADER_SIZE)
+    if not any(header):
+        dev.close()
+        print("Flight recorder is not enabled in this firmware build")
+        sys.exit(1)
+
+    head, frozen, cause, trigger, freeze_time, _ = unpack(HEADER_FMT, header)
+    if not frozen:
+        dev.close()
+        print("Flight recorder is still recording; freeze it first (run without --no-freeze)")
+        sys.exit(1)
+
+    data = dev.read_block(DIAG_BLOCK_FLIGHT_RECORDER, HEADER_SIZE + RECORD_SIZE * args.records)
+    dev.close()
+
+    records = [unpack(RECORD_FMT, data[HEADER_SIZE + i * RECORD_SIZE:]) for i in range(args.records)]
+
+    # Oldest record first; never written records have a zero event
+    records = full_times([r for r in records[head:] + records[:head] if r[1]], freeze_time)
+
+    print(f"Frozen by: {CAUSES.get(cause, cause)}, trigger note: {'none' if trigger == 0xFF else trigger}")
+    print(f"{len(records)} records, times relative to the freeze")
+    print()
+
+    previous = None
+    for time, event, data in records:
+        source, text = describe(event, data)
+        delta = f"+{ticks_to_ms(time - previous):8.3f}" if previous is not None else " " * 9
+        print(f"{ticks_to_ms(time - freeze_time):10.3f} ms {delta}  {source:<9} {text}")
+        previous = time
+
+
+if __name__ == "__main__":
+    main()
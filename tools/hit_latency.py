@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+End-to-End Hit Latency Monitor for Rock Band MIDI-to-USB Drum Controller
+
+Measures the time from a MIDI message arriving at the controller to the HID
+report it produced being returned by a read on the host, per hit. Needs
+firmware built with DIAG_REPORT_TIMESTAMPS (and preferably ENABLE_CLOCK_SYNC),
+which puts the arrival time, endpoint write time and USB frame number into
+the vendor16 fields of every queued report. Device times are mapped onto the
+host's CLOCK_MONOTONIC with clocksync.py, resynchronised every few seconds.
+
+Only reports produced by a note on that set a pad, kick or pedal bit are
+measured; the idle report the firmware sends between them carries no
+timestamps, and releases are skipped. Each hit is split into:
+    device   MIDI arrival to the report being written to the IN endpoint
+    usb+host endpoint write to the host read returning
+    total    the two together
+
+Usage:
+    python3 hit_latency.py [--count 100] [--resync 5]
+
+Requirements:
+    pip install hidapi
+
+Notes:
+    The error bound printed at each resync is half the fastest round trip
+    seen by the clock synchronisation; every total carries that much
+    uncertainty on top of the host's own read wake-up jitter.
+"""
+
+import argparse
+import statistics
+import struct
+import time
+
+from rb_diag import DiagDevice, TICKS_PER_US
+from clocksync import ClockSync, monotonic_ns
+
+# HIDReport_t: buttons, hat, axes and vendor8 come first
+REPORT_SIZE = 27
+MESSAGE_OFFSET = 16
+VENDOR16_OFFSET = 19
+
+# Hit bits: pads and kick in button[0], hi-hat pedal in button[1]
+PAD_BITS = 0x1F
+PEDAL_BIT = 0x02
+
+# vendor16 of default_report, which the endpoint sends whenever no report is queued
+IDLE_VENDOR16 = (0x0002, 0x0002, 0x0002, 0x0002)
+
+
+def summary(name, values):
+    values = sorted(values)
+    p99 = values[min(len(values) - 1, int(len(values) * 0.99))]
+    print(f"{name:>9}: min {values[0]:8.1f}  median {statistics.median(values):8.1f}  "
+          f"p99 {p99:8.1f}  max {values[-1]:8.1f} us")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Measure MIDI-to-host latency for every hit",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__
+    )
+    parser.add_argument("--count", type=int, default=0, help="Stop after this many hits (default: run until Ctrl+C)")
+    parser.add_argument("--resync", type=float, default=5.0, help="Seconds between clock resyncs (default: 5)")
+    args = parser.parse_args()
+
+    dev = DiagDevice()
+    sync = ClockSync(dev)
+    print("Synchronising clocks...")
+    sync.update(128, interval=0.002)
+    print(f"Drift {sync.drift_ppm:+.2f} ppm, error +/-{sync.error_ns / 1000.0:.1f} us\n")
+
+    device_us, usb_us, total_us = [], [], []
+    last_arrival = None
+    next_resync = time.monotonic() + args.resync
+    skip = False
+
+    print(f"{'hit':>5} {'frame':>6} {'device us':>10} {'usb+host us':>12} {'total us':>9}")
+    try:
+        while not args.count or len(total_us) < args.count:
+            if time.monotonic() >= next_resync:
+                sync.update(32, interval=0.002)
+                next_resync = time.monotonic() + args.resync
+                # The report that queued up during the resync would show the resync time
+                skip = True
+
+            data = dev.h.read(64, 100)
+            read_ns = monotonic_ns()
+            if len(data) < REPORT_SIZE:
+                continue
+
+            # Only reports for a hit carry a stamp worth pairing: the idle report has no arrival
+            # time at all, and a release would count its hit twice. vendor8[9..11] hold the
+            # message behind the report
+            stamp = struct.unpack_from("<4H", bytes(data), VENDOR16_OFFSET)
+            status, _, velocity = data[MESSAGE_OFFSET:MESSAGE_OFFSET + 3]
+            if stamp == IDLE_VENDOR16 or not (data[0] & PAD_BITS or data[1] & PEDAL_BIT):
+                continue
+            if status & 0xF0 != 0x90 or velocity == 0:
+                continue
+
+            arrival_lo, arrival_hi, written, frame = stamp
+            arrival = arrival_lo | arrival_hi << 16
+            if arrival == last_arrival:
+                continue
+            last_arrival = arrival
+            if skip:
+                skip = False
+                continue
+
+            # The write time is always after the arrival and less than 32ms later
+            written_ticks = (written - arrival) & 0xFFFF
+            device = written_ticks / TICKS_PER_US
+            total = (read_ns - sync.to_host_ns(arrival)) / 1000.0
+
+            device_us.append(device)
+            usb_us.append(total - device)
+            total_us.append(total)
+            print(f"{len(total_us):5d} {frame & 0x7FF:6d} {device:10.1f} {total - device:12.1f} {total:9.1f}")
+    except KeyboardInterrupt:
+        pass
+
+    dev.close()
+
+    if total_us:
+        print(f"\n{len(total_us)} hits; usb+host and total times carry the clock offset error, "
+              f"+/-{sync.error_ns / 1000.0:.1f} us")
+        summary("device", device_us)
+        summary("usb+host", usb_us)
+        summary("total", total_us)
+
+
+if __name__ == "__main__":
+    main()
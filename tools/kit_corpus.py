@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""
+Kit MIDI Load Corpus Format for Rock Band MIDI-to-USB Drum Controller
+
+A corpus file holds the byte stream a drum kit sends down its MIDI cable,
+with the time each byte starts on the wire. It is laid out so it can be
+memory-mapped and replayed without parsing:
+
+    offset 0   header, 64 bytes, little-endian:
+                 magic     4s  b"RBKC"
+                 version   H   1
+                 header    H   64
+                 count     I   number of stream bytes
+                 segments  I   number of index entries
+                 duration  I   start time of the last byte, in microseconds
+                 seed      I   generator seed
+                 flags     I   CORPUS_FLAG_* describing the content
+                 name      36s song name, UTF-8, zero padded
+    64         index, `segments` entries of (first byte I, start time us I)
+    ...        stream bytes, u8[count], padded to an even length
+    ...        time deltas, u16[count], microseconds since the previous byte
+
+The first byte of each segment has a zero delta; its time comes from the
+index. A new segment starts every SEGMENT_BYTES bytes and wherever the gap
+to the previous byte does not fit in 16 bits, so any point in the stream can
+be reached through the index, and segments can be replayed independently.
+Times are 32-bit microseconds, limiting a file to about 71 minutes.
+"""
+
+import mmap
+import struct
+
+MAGIC = b"RBKC"
+VERSION = 1
+
+HEADER_FMT = "<4sHHIIIII36s"
+HEADER_SIZE = 64
+INDEX_FMT = "<II"
+INDEX_SIZE = 8
+
+# Index granularity, in stream bytes
+SEGMENT_BYTES = 4096
+
+# MIDI byte time at 31,250 baud: 10 bits
+BYTE_US = 320
+
+CORPUS_FLAG_RUNNING_STATUS = 0x01
+CORPUS_FLAG_CLOCK = 0x02
+CORPUS_FLAG_ACTIVE_SENSING = 0x04
+CORPUS_FLAG_HIHAT_CC4 = 0x08
+CORPUS_FLAG_CROSSTALK = 0x10
+
+assert struct.calcsize(HEADER_FMT) == HEADER_SIZE
+
+
+def write_corpus(path, stream, name="", seed=0, flags=0):
+    """Write a corpus file from a list of (time_us, byte) in time order."""
+    index = []
+    data = bytearray()
+    deltas = []
+    previous = None
+
+    for i, (time, byte) in enumerate(stream):
+        if previous is not None and time < previous:
+            raise ValueError(f"stream byte {i} goes back in time")
+        delta = None if previous is None else time - previous
+        if delta is None or delta > 0xFFFF or (i % SEGMENT_BYTES) == 0:
+            index.append((i, time))
+            delta = 0
+        data.append(byte)
+        deltas.append(delta)
+        previous = time
+
+    if len(data) % 2:
+        data.append(0)
+
+    duration = stream[-1][0] if stream else 0
+    header = struct.pack(HEADER_FMT, MAGIC, VERSION, HEADER_SIZE, len(stream), len(index),
+                         duration, seed & 0xFFFFFFFF, flags, name.encode("utf-8")[:36])
+
+    with open(path, "wb") as f:
+        f.write(header)
+        for entry in index:
+            f.write(struct.pack(INDEX_FMT, *entry))
+        f.write(data)
+        f.write(struct.pack(f"<{len(deltas)}H", *deltas))
+
+
+class Corpus:
+    """Memory-mapped, read-only view of a corpus file."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        (magic, version, header_size, self.count, self.segments, self.duration,
+         self.seed, self.flags, name) = struct.unpack_from(HEADER_FMT, self.map, 0)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f"{path}: not a version {VERSION} kit corpus")
+        self.name = name.rstrip(b"\0").decode("utf-8", "replace")
+
+        index_offset = header_size
+        data_offset = index_offset + self.segments * INDEX_SIZE
+        delta_offset = data_offset + self.count + (self.count % 2)
+
+        view = memoryview(self.map)
+        self.index = view[index_offset:data_offset].cast("I")
+        self.data = view[data_offset:data_offset + self.count]
+        self.deltas = view[delta_offset:delta_offset + 2 * self.count].cast("H")
+
+    def close(self):
+        self.index.release()
+        self.data.release()
+        self.deltas.release()
+        self.map.close()
+
+    def segment(self, n):
+        """Return (first byte, last byte + 1, start time) of segment n."""
+        first, time = self.index[2 * n], self.index[2 * n + 1]
+        end = self.index[2 * n + 2] if n + 1 < self.segments else self.count
+        return first, end, time
+
+    def seek(self, time):
+        """Return the segment containing `time` (microseconds)."""
+        lo, hi = 0, self.segments - 1
+        while lo < hi:
+            mid = (lo + hi + 1) // 2
+            if self.index[2 * mid + 1] <= time:
+                lo = mid
+            else:
+                hi = mid - 1
+        return lo
+
+    def __iter__(self):
+        """Yield (time_us, byte) for the whole stream."""
+        for n in range(self.segments):
+            first, end, time = self.segment(n)
+            for i in range(first, end):
+                time += self.deltas[i]
+                yield time, self.data[i]
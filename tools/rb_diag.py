@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""
+Diagnostics channel helper for Rock Band MIDI-to-USB Drum Controller
+
+Shared helper for the tools that read diagnostic data out of the firmware
+through the 8-byte vendor feature report (see Diagnostics.h). The host selects
+a block with a SET_REPORT (Feature) and then streams it with GET_REPORT
+(Feature) requests, each returning the next 5 bytes.
+
+Requirements:
+    pip install hidapi
+"""
+
+import sys
+import struct
+
+# Harmonix Rock Band Drums VID/PID
+VID = 0x1BAD
+PID = 0x3110
+
+# Must match Diagnostics.h
+DIAG_REPORT_SIZE = 8
+DIAG_CHUNK_SIZE = DIAG_REPORT_SIZE - 3
+
+DIAG_CMD_SELECT = 0x01
+DIAG_CMD_RECORDER_FREEZE = 0x02
+DIAG_CMD_RECORDER_ARM = 0x03
+
+DIAG_BLOCK_BOOT_TRACE = 0x00
+DIAG_BLOCK_SCHEDULER_STATS = 0x01
+DIAG_BLOCK_SCHEDULER_TASKS = 0x02
+DIAG_BLOCK_MIDI_INPUT = 0x03
+DIAG_BLOCK_FLIGHT_RECORDER = 0x04
+DIAG_BLOCK_MIDI_THRU = 0x05
+DIAG_BLOCK_CLOCK = 0x06
+DIAG_BLOCK_USB_INTERRUPTS = 0x07
+DIAG_BLOCK_MIDI_STREAM = 0x08
+
+# Timebase ticks per microsecond (Timer1 at F_CPU/8, 16MHz)
+TICKS_PER_US = 2
+
+
+class DiagDevice:
+    """Diagnostics channel of a connected controller."""
+
+    def __init__(self, vid=VID, pid=PID):
+        try:
+            import hid
+        except ImportError:
+            print("Error: hidapi not installed")
+            print("Install with: pip install hidapi")
+            sys.exit(1)
+
+        self.h = hid.device()
+        self.h.open(vid, pid)
+
+    def close(self):
+        self.h.close()
+
+    def command(self, *payload):
+        """Send a diagnostics command (SET_REPORT Feature)."""
+        report = list(payload) + [0] * (DIAG_REPORT_SIZE - len(payload))
+        # Leading 0x00 is the report ID, the descriptor does not use report IDs
+        self.h.send_feature_report([0x00] + report)
+
+    def chunk(self):
+        """Read one diagnostics chunk (GET_REPORT Feature)."""
+        data = self.h.get_feature_report(0x00, DIAG_REPORT_SIZE + 1)
+        return bytes(data[-DIAG_REPORT_SIZE:])
+
+    def read_block(self, block, length, offset=0):
+        """Read `length` bytes of a diagnostic block, starting at `offset`."""
+        self.command(DIAG_CMD_SELECT, block, offset & 0xFF, offset >> 8)
+
+        data = b""
+        while len(data) < length:
+            chunk = self.chunk()
+            if chunk[0] != block:
+                raise IOError(f"Unexpected block 0x{chunk[0]:02X} in response")
+            data += chunk[3:]
+
+        return data[:length]
+
+
+def ticks_to_ms(ticks):
+    """Convert timebase ticks to milliseconds."""
+    return ticks / TICKS_PER_US / 1000.0
+
+
+def unpack(fmt, data):
+    """Unpack little-endian, unpadded AVR structure data."""
+    return struct.unpack("<" + fmt, data[:struct.calcsize("<" + fmt)])
@@ -0,0 +1,632 @@
+/*
+ * Rock Band MIDI-to-USB Drum Controller for Nintendo Wii
+ *
+ * rbmidid - Linux daemon turning MIDI kits into Rock Band drum gamepads
+ *
+ * Copyright (c) 2024 Rock Band MIDI-to-USB Drum Controller Contributors
+ *
+ * This file is part of the Rock Band MIDI-to-USB project.
+ * Licensed under the MIT License - see LICENSE file for details.
+ */
+
+/*
+ * Each kit reads MIDI from an ALSA rawmidi device (raw:/dev/snd/midiC1D0) or, when built with
+ * alsa-lib, an ALSA sequencer port (seq:CLIENT:PORT), runs it through the same DrumCore parser
+ * and report logic as the firmware, and emits the reports through a uhid device created with
+ * the firmware's HID report descriptor, paced like the firmware's endpoint at the HID polling
+ * interval. All kits share one epoll loop, run from a SCHED_FIFO thread. Replay mode (-r) reads
+ * raw MIDI from stdin and prints each report followed by the idle report instead, for comparing
+ * against captures of the firmware.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/uhid.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#if defined(WITH_ALSA_SEQ)
+#include <alsa/asoundlib.h>
+#endif
+
+#include "DrumCore.h"
+
+// HIDReportData.h relies on these from LUFA's Common.h
+#define CONCAT(x, y)            x ## y
+#define CONCAT_EXPANDED(x, y)   CONCAT(x, y)
+#include "HIDReportData.h"
+#include "HIDReportDescriptor.h"
+
+#define MAX_KITS 8
+#define READ_SIZE 64
+
+// The firmware's report queue depth (BUFFER_SIZE in rockband.c) and HID IN endpoint polling
+// interval (Descriptors.c); the uhid device hands reports out at the same pace
+#define REPORT_QUEUE_SIZE 8
+#define POLL_INTERVAL_NS 10000000L
+
+#define VID 0x1BAD
+#define PID 0x3110
+
+// Tags in the upper byte of epoll_event.data.u32, kit index in the low byte
+#define TAG_INPUT  0x100
+#define TAG_UHID   0x200
+#define TAG_SIGNAL 0x300
+#define TAG_TIMER  0x400
+#define TAG_POLL   0x500
+
+// Latency histogram bucket upper bounds, in microseconds
+static const uint32_t bucket_us[] = {10, 20, 50, 100, 200, 500, 1000};
+#define BUCKETS (sizeof(bucket_us) / sizeof(bucket_us[0]) + 1)
+
+static const uint8_t report_descriptor[] = { ROCKBAND_HID_REPORT_DESCRIPTOR };
+
+typedef struct {
+    uint64_t reports;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t buckets[BUCKETS];
+} latency_stats_t;
+
+typedef struct {
+    HIDReport_t report;
+    uint64_t t0;
+} queued_report_t;
+
+typedef struct {
+    char source[64];
+    int in_fd;
+    int uhid_fd;
+    int poll_fd;
+    MidiParser_t parser;
+    HIDReport_t report;
+    // Reports waiting for the next poll, oldest first; polling is set while the last report sent
+    // is still current
+    queued_report_t queue[REPORT_QUEUE_SIZE];
+    unsigned queue_head;
+    unsigned queue_count;
+    int polling;
+    latency_stats_t stats;
+#if defined(WITH_ALSA_SEQ)
+    snd_seq_t *seq;
+#endif
+} kit_t;
+
+static kit_t kits[MAX_KITS];
+static int total_kits;
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static int rt_priority = 50;
+static int stats_interval;
+static const char *stats_path;
+static int replay;
+static int replay_messages;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void stats_record(latency_stats_t *stats, uint64_t ns) {
+    uint32_t us = ns / 1000;
+    size_t b = 0;
+
+    while (b < BUCKETS - 1 && us >= bucket_us[b])
+        b++;
+
+    if (stats->reports == 0 || ns < stats->min_ns)
+        stats->min_ns = ns;
+    if (ns > stats->max_ns)
+        stats->max_ns = ns;
+
+    stats->reports++;
+    stats->sum_ns += ns;
+    stats->buckets[b]++;
+}
+
+static void stats_dump(FILE *out) {
+    for (int i = 0; i < total_kits; i++) {
+        latency_stats_t *s = &kits[i].stats;
+
+        fprintf(out, "kit %d %s: reports=%llu", i, kits[i].source, (unsigned long long)s->reports);
+        if (s->reports) {
+            fprintf(out, " min=%.1fus mean=%.1fus max=%.1fus",
+                    s->min_ns / 1000.0, s->sum_ns / 1000.0 / s->reports, s->max_ns / 1000.0);
+        }
+        fprintf(out, " hist=");
+        for (size_t b = 0; b < BUCKETS; b++) {
+            if (b < BUCKETS - 1)
+                fprintf(out, "%s<%u:%llu", b ? "," : "", bucket_us[b], (unsigned long long)s->buckets[b]);
+            else
+                fprintf(out, ",>=%u:%llu", bucket_us[b - 1], (unsigned long long)s->buckets[b]);
+        }
+        fprintf(out, "\n");
+    }
+    fflush(out);
+}
+
+static void stats_export(void) {
+    stats_dump(stderr);
+
+    if (stats_path) {
+        FILE *f = fopen(stats_path, "w");
+        if (f) {
+            stats_dump(f);
+            fclose(f);
+        }
+    }
+}
+
+static int uhid_write(int fd, const struct uhid_event *ev) {
+    ssize_t ret = write(fd, ev, sizeof(*ev));
+    return (ret == (ssize_t)sizeof(*ev)) ? 0 : -1;
+}
+
+static int uhid_create(kit_t *kit, int index) {
+    struct uhid_event ev;
+
+    kit->uhid_fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+    if (kit->uhid_fd < 0) {
+        fprintf(stderr, "rbmidid: cannot open /dev/uhid: %s\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_CREATE2;
+    snprintf((char *)ev.u.create2.name, sizeof(ev.u.create2.name), "Harmonix Drum Controller for Nintendo Wii");
+    snprintf((char *)ev.u.create2.phys, sizeof(ev.u.create2.phys), "rbmidid/kit%d", index);
+    snprintf((char *)ev.u.create2.uniq, sizeof(ev.u.create2.uniq), "%s", kit->source);
+    memcpy(ev.u.create2.rd_data, report_descriptor, sizeof(report_descriptor));
+    ev.u.create2.rd_size = sizeof(report_descriptor);
+    ev.u.create2.bus = BUS_USB;
+    ev.u.create2.vendor = VID;
+    ev.u.create2.product = PID;
+    ev.u.create2.version = 0x0200;
+    ev.u.create2.country = 0;
+
+    if (uhid_write(kit->uhid_fd, &ev) < 0) {
+        fprintf(stderr, "rbmidid: cannot create uhid device: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+// Answer the kernel's uhid requests; the daemon has no feature or output reports to offer
+static void uhid_service(kit_t *kit) {
+    struct uhid_event ev, reply;
+
+    if (read(kit->uhid_fd, &ev, sizeof(ev)) <= 0)
+        return;
+
+    memset(&reply, 0, sizeof(reply));
+    switch (ev.type) {
+        case UHID_GET_REPORT:
+            reply.type = UHID_GET_REPORT_REPLY;
+            reply.u.get_report_reply.id = ev.u.get_report.id;
+            reply.u.get_report_reply.err = EIO;
+            uhid_write(kit->uhid_fd, &reply);
+            break;
+        case UHID_SET_REPORT:
+            reply.type = UHID_SET_REPORT_REPLY;
+            reply.u.set_report_reply.id = ev.u.set_report.id;
+            uhid_write(kit->uhid_fd, &reply);
+            break;
+        default:
+            break;
+    }
+}
+
+static void emit_frame(kit_t *kit, const HIDReport_t *report) {
+    if (replay) {
+        const uint8_t *bytes = (const uint8_t *)report;
+        for (size_t i = 0; i < sizeof(HIDReport_t); i++)
+            printf("%02X%s", bytes[i], (i + 1 < sizeof(HIDReport_t)) ? " " : "\n");
+        return;
+    }
+
+    struct uhid_event ev;
+    ev.type = UHID_INPUT2;
+    ev.u.input2.size = sizeof(HIDReport_t);
+    memcpy(ev.u.input2.data, report, sizeof(HIDReport_t));
+
+    // Only the header and the report itself need to reach the kernel
+    size_t len = offsetof(struct uhid_event, u.input2.data) + sizeof(HIDReport_t);
+    if (write(kit->uhid_fd, &ev, len) < 0)
+        fprintf(stderr, "rbmidid: %s: uhid write failed: %s\n", kit->source, strerror(errno));
+}
+
+static void poll_arm(kit_t *kit, int on) {
+    struct itimerspec its = { .it_interval = { 0, on ? POLL_INTERVAL_NS : 0 },
+                              .it_value = { 0, on ? POLL_INTERVAL_NS : 0 } };
+    if (timerfd_settime(kit->poll_fd, 0, &its, NULL) < 0)
+        fprintf(stderr, "rbmidid: %s: poll timer failed: %s\n", kit->source, strerror(errno));
+    kit->polling = on;
+}
+
+// Hands reports out the way the firmware's endpoint task does at each IN poll: the next queued
+// report if there is one, otherwise default_report. A report therefore stays current for a whole
+// poll interval, and a burst of hits goes out back to back. The first report after an idle
+// period goes out at once rather than waiting for a poll phase the daemon cannot know.
+static void emit_report(kit_t *kit, uint64_t t0) {
+    if (replay) {
+        // Compare mode: the frame a capture shows after the report once the queue has drained
+        emit_frame(kit, &kit->report);
+        emit_frame(kit, &default_report);
+        return;
+    }
+
+    if (!kit->polling) {
+        emit_frame(kit, &kit->report);
+        stats_record(&kit->stats, now_ns() - t0);
+        poll_arm(kit, 1);
+        return;
+    }
+
+    // Queue full: the oldest unsent report makes way, as in the firmware
+    if (kit->queue_count == REPORT_QUEUE_SIZE) {
+        kit->queue_head = (kit->queue_head + 1) % REPORT_QUEUE_SIZE;
+        kit->queue_count--;
+    }
+
+    queued_report_t *q = &kit->queue[(kit->queue_head + kit->queue_count) % REPORT_QUEUE_SIZE];
+    q->report = kit->report;
+    q->t0 = t0;
+    kit->queue_count++;
+}
+
+static void poll_service(kit_t *kit) {
+    uint64_t expirations;
+
+    if (read(kit->poll_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return;
+
+    if (kit->queue_count) {
+        queued_report_t *q = &kit->queue[kit->queue_head];
+        kit->queue_head = (kit->queue_head + 1) % REPORT_QUEUE_SIZE;
+        kit->queue_count--;
+        emit_frame(kit, &q->report);
+        stats_record(&kit->stats, now_ns() - q->t0);
+    } else {
+        emit_frame(kit, &default_report);
+        poll_arm(kit, 0);
+    }
+}
+
+static void apply_message(kit_t *kit, const uint8_t *msg, uint64_t t0) {
+    if (report_apply_message(&kit->report, msg) & REPORT_CHANGED)
+        emit_report(kit, t0);
+}
+
+static void feed_bytes(kit_t *kit, const uint8_t *bytes, size_t len, uint64_t t0) {
+    for (size_t i = 0; i < len; i++) {
+        if (midi_parse_byte(&kit->parser, bytes[i])) {
+            if (replay_messages)
+                printf("# %02X %02X %02X\n", kit->parser.buffer[0], kit->parser.buffer[1], kit->parser.buffer[2]);
+            apply_message(kit, kit->parser.buffer, t0);
+        }
+    }
+}
+
+#if defined(WITH_ALSA_SEQ)
+static int seq_open(kit_t *kit, const char *addr) {
+    snd_seq_addr_t sender;
+    int port;
+
+    if (snd_seq_open(&kit->seq, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0)
+        return -1;
+
+    snd_seq_set_client_name(kit->seq, "rbmidid");
+    port = snd_seq_create_simple_port(kit->seq, "in",
+                                      SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+                                      SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    if (port < 0 || snd_seq_parse_address(kit->seq, &sender, addr) < 0 ||
+        snd_seq_connect_from(kit->seq, port, sender.client, sender.port) < 0)
+        return -1;
+
+    struct pollfd pfd;
+    if (snd_seq_poll_descriptors(kit->seq, &pfd, 1, POLLIN) != 1)
+        return -1;
+
+    kit->in_fd = pfd.fd;
+    return 0;
+}
+
+// Sequencer events arrive already parsed; rebuild the channel message the parser would produce
+static void seq_service(kit_t *kit, uint64_t t0) {
+    snd_seq_event_t *ev;
+
+    while (snd_seq_event_input(kit->seq, &ev) >= 0) {
+        uint8_t msg[MIDI_SIZE] = {0, 0, 0};
+
+        switch (ev->type) {
+            case SND_SEQ_EVENT_NOTEON:
+            case SND_SEQ_EVENT_NOTEOFF:
+            case SND_SEQ_EVENT_KEYPRESS:
+                msg[0] = (ev->type == SND_SEQ_EVENT_NOTEON ? NOTE_ON :
+                          ev->type == SND_SEQ_EVENT_NOTEOFF ? NOTE_OFF : 0xA0) | ev->data.note.channel;
+                msg[1] = ev->data.note.note;
+                msg[2] = ev->data.note.velocity;
+                break;
+            case SND_SEQ_EVENT_CONTROLLER:
+                msg[0] = CONTROL_CHANGE | ev->data.control.channel;
+                msg[1] = ev->data.control.param;
+                msg[2] = ev->data.control.value;
+                break;
+            case SND_SEQ_EVENT_PGMCHANGE:
+            case SND_SEQ_EVENT_CHANPRESS:
+                // Two byte messages: the firmware parser leaves the stale third byte in place
+                msg[0] = (ev->type == SND_SEQ_EVENT_PGMCHANGE ? 0xC0 : 0xD0) | ev->data.control.channel;
+                msg[1] = ev->data.control.value;
+                msg[2] = kit->parser.buffer[2];
+                break;
+            default:
+                continue;
+        }
+
+        kit->parser.buffer[0] = msg[0];
+        kit->parser.buffer[1] = msg[1];
+        kit->parser.buffer[2] = msg[2];
+        apply_message(kit, msg, t0);
+    }
+}
+#endif
+
+static int kit_open(const char *spec) {
+    if (total_kits == MAX_KITS) {
+        fprintf(stderr, "rbmidid: too many kits (max %d)\n", MAX_KITS);
+        return -1;
+    }
+
+    kit_t *kit = &kits[total_kits];
+    snprintf(kit->source, sizeof(kit->source), "%s", spec);
+    kit->report = default_report;
+
+    if (strncmp(spec, "raw:", 4) == 0) {
+        kit->in_fd = open(spec + 4, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (kit->in_fd < 0) {
+            fprintf(stderr, "rbmidid: cannot open %s: %s\n", spec + 4, strerror(errno));
+            return -1;
+        }
+    } else if (strncmp(spec, "seq:", 4) == 0) {
+#if defined(WITH_ALSA_SEQ)
+        if (seq_open(kit, spec + 4) < 0) {
+            fprintf(stderr, "rbmidid: cannot connect to sequencer port %s\n", spec + 4);
+            return -1;
+        }
+#else
+        fprintf(stderr, "rbmidid: built without ALSA sequencer support, use raw: or rebuild with alsa-lib\n");
+        return -1;
+#endif
+    } else {
+        fprintf(stderr, "rbmidid: unknown kit source '%s' (expected raw:PATH or seq:CLIENT:PORT)\n", spec);
+        return -1;
+    }
+
+    if (uhid_create(kit, total_kits) < 0)
+        return -1;
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = TAG_INPUT | total_kits };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, kit->in_fd, &ev) < 0) {
+        fprintf(stderr, "rbmidid: cannot watch %s: %s\n", spec, strerror(errno));
+        return -1;
+    }
+    ev.data.u32 = TAG_UHID | total_kits;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, kit->uhid_fd, &ev) < 0) {
+        fprintf(stderr, "rbmidid: cannot watch uhid device for %s: %s\n", spec, strerror(errno));
+        return -1;
+    }
+
+    kit->poll_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    ev.data.u32 = TAG_POLL | total_kits;
+    if (kit->poll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, kit->poll_fd, &ev) < 0) {
+        fprintf(stderr, "rbmidid: cannot set up the poll timer for %s: %s\n", spec, strerror(errno));
+        return -1;
+    }
+
+    total_kits++;
+    return 0;
+}
+
+static void kit_service(kit_t *kit) {
+    uint64_t t0 = now_ns();
+
+#if defined(WITH_ALSA_SEQ)
+    if (kit->seq) {
+        seq_service(kit, t0);
+        return;
+    }
+#endif
+
+    uint8_t bytes[READ_SIZE];
+    ssize_t len;
+
+    while ((len = read(kit->in_fd, bytes, sizeof(bytes))) > 0)
+        feed_bytes(kit, bytes, len, t0);
+}
+
+static void *event_loop(void *arg) {
+    int signal_fd = *(int *)arg;
+    struct epoll_event events[3 * MAX_KITS + 2];
+
+    for (;;) {
+        int n = epoll_wait(epoll_fd, events, sizeof(events) / sizeof(events[0]), -1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            break;
+
+        for (int i = 0; i < n; i++) {
+            uint32_t tag = events[i].data.u32 & 0xFF00;
+            uint32_t index = events[i].data.u32 & 0xFF;
+
+            if (tag == TAG_INPUT) {
+                kit_service(&kits[index]);
+            } else if (tag == TAG_UHID) {
+                uhid_service(&kits[index]);
+            } else if (tag == TAG_POLL) {
+                poll_service(&kits[index]);
+            } else if (tag == TAG_TIMER) {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+                    stats_export();
+            } else if (tag == TAG_SIGNAL) {
+                struct signalfd_siginfo si;
+                if (read(signal_fd, &si, sizeof(si)) != sizeof(si))
+                    continue;
+                if (si.ssi_signo == SIGUSR1) {
+                    stats_export();
+                    continue;
+                }
+                return NULL;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int replay_stdin(void) {
+    kit_t *kit = &kits[0];
+    uint8_t bytes[READ_SIZE];
+    ssize_t len;
+
+    snprintf(kit->source, sizeof(kit->source), "stdin");
+    kit->report = default_report;
+    total_kits = 1;
+
+    while ((len = read(STDIN_FILENO, bytes, sizeof(bytes))) > 0)
+        feed_bytes(kit, bytes, len, 0);
+
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage: rbmidid [options] KIT...\n"
+        "       rbmidid -r [-m] < input.mid.raw\n"
+        "\n"
+        "KIT is raw:/dev/snd/midiCxDy (ALSA rawmidi) or seq:CLIENT:PORT (ALSA sequencer).\n"
+        "Each kit gets its own uhid Rock Band drum controller (1bad:3110).\n"
+        "\n"
+        "Options:\n"
+        "  -p PRIO   SCHED_FIFO priority of the event thread (default 50, 0 = normal scheduling)\n"
+        "  -s SEC    print latency statistics every SEC seconds (always on SIGUSR1 and exit)\n"
+        "  -o FILE   also write the statistics to FILE\n"
+        "  -r        replay raw MIDI from stdin and print the report frames as hex\n"
+        "  -m        with -r, also print each parsed message as a '#' line before its frames\n");
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:s:o:rmh")) != -1) {
+        switch (opt) {
+            case 'p': rt_priority = atoi(optarg); break;
+            case 's': stats_interval = atoi(optarg); break;
+            case 'o': stats_path = optarg; break;
+            case 'r': replay = 1; break;
+            case 'm': replay_messages = 1; break;
+            default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (replay)
+        return replay_stdin();
+
+    if (optind == argc) {
+        usage();
+        return 1;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        fprintf(stderr, "rbmidid: cannot create epoll instance: %s\n", strerror(errno));
+        return 1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (kit_open(argv[i]) < 0)
+            return 1;
+    }
+
+    // Signals are handled by the event thread through a signalfd
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        fprintf(stderr, "rbmidid: cannot create signalfd: %s\n", strerror(errno));
+        return 1;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = TAG_SIGNAL };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev) < 0) {
+        fprintf(stderr, "rbmidid: cannot watch signalfd: %s\n", strerror(errno));
+        return 1;
+    }
+
+    if (stats_interval > 0) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        struct itimerspec its = { .it_interval = { stats_interval, 0 }, .it_value = { stats_interval, 0 } };
+        ev.data.u32 = TAG_TIMER;
+        if (timer_fd < 0 || timerfd_settime(timer_fd, 0, &its, NULL) < 0 ||
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) < 0) {
+            fprintf(stderr, "rbmidid: cannot set up the statistics timer: %s\n", strerror(errno));
+            return 1;
+        }
+    }
+
+    // Keep page faults out of the event path
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+        fprintf(stderr, "rbmidid: mlockall failed: %s\n", strerror(errno));
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+
+    if (rt_priority > 0) {
+        struct sched_param param = { .sched_priority = rt_priority };
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    if (pthread_create(&thread, &attr, event_loop, &signal_fd) != 0) {
+        fprintf(stderr, "rbmidid: no permission for SCHED_FIFO, running with normal scheduling\n");
+        pthread_attr_destroy(&attr);
+        pthread_attr_init(&attr);
+        if (pthread_create(&thread, &attr, event_loop, &signal_fd) != 0)
+            return 1;
+    }
+
+    pthread_join(thread, NULL);
+    stats_export();
+
+    for (int i = 0; i < total_kits; i++) {
+        struct uhid_event destroy = { .type = UHID_DESTROY };
+        uhid_write(kits[i].uhid_fd, &destroy);
+    }
+
+    return 0;
+}